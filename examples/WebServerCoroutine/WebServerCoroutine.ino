@@ -0,0 +1,103 @@
+/*
+ * ESP32 - Coroutine Handlers Example
+ *
+ * This example demonstrates route handlers written as C++20 coroutines. A
+ * handler can wait (co_await) for a timer, for room in the socket's send
+ * buffer or for more request body, and the server keeps serving other
+ * clients meanwhile:
+ * - GET /api/slow answers after a 500 ms wait (e.g. a sensor conversion)
+ * - GET /api/stream sends 100 lines, one every 20 ms
+ * - POST /api/upload reads the body piece by piece and answers with its size
+ *   and checksum
+ *
+ * Needs a toolchain with C++20 coroutines (ESP32 Arduino core 3.x). With an
+ * older core the sketch still builds and every route says so.
+ *
+ * Test with:
+ *   curl http://<ip>/api/slow
+ *   curl -N http://<ip>/api/stream
+ *   curl --data-binary @somefile http://<ip>/api/upload
+ *
+ * Hardware: ESP32 Board
+ * Library: DIYables_ESP32_WebServer
+ */
+
+#include <DIYables_ESP32_WebServer.h>
+
+// WiFi credentials
+const char WIFI_SSID[] = "YOUR_WIFI_SSID";
+const char WIFI_PASSWORD[] = "YOUR_WIFI_PASSWORD";
+
+// Create web server instance
+DIYables_ESP32_WebServer server;
+
+#if WEBSERVER_COROUTINES
+
+Task handleSlow(Request& request, Response& response) {
+  co_await sleepFor(500);  // other clients are served during the wait
+  response.begin("application/json");
+  response.print("{\"temperature\":");
+  response.print(20.0 + random(0, 100) / 10.0, 1);
+  response.print("}");
+}
+
+Task handleStream(Request& request, Response& response) {
+  response.begin("text/plain");
+  for (int i = 1; i <= 100 && response.connected(); i++) {
+    co_await response.writable();
+    response.print("line ");
+    response.println(i);
+    co_await sleepFor(20);
+  }
+}
+
+Task handleUpload(Request& request, Response& response) {
+  uint8_t buffer[256];
+  uint32_t checksum = 0;
+  size_t total = 0;
+  while (!request.bodyComplete()) {
+    int n = co_await request.read(buffer, sizeof(buffer));
+    if (n <= 0) break;  // client went away
+    for (int i = 0; i < n; i++) {
+      checksum = checksum * 31 + buffer[i];
+    }
+    total += n;
+  }
+
+  char json[64];
+  snprintf(json, sizeof(json), "{\"bytes\":%u,\"checksum\":%lu}", (unsigned)total, (unsigned long)checksum);
+  response.begin("application/json");
+  response.print(json);
+}
+
+#else
+
+void handleUnsupported(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData) {
+  server.sendResponse(client, "This build has no C++20 coroutines (ESP32 Arduino core 3.x needed)", "text/plain");
+}
+
+#endif
+
+void setup() {
+  Serial.begin(9600);
+
+  // Initialize web server with WiFi credentials
+  server.begin(WIFI_SSID, WIFI_PASSWORD);
+
+  // Add routes
+#if WEBSERVER_COROUTINES
+  server.addRoute("/api/slow", handleSlow);
+  server.addRoute("/api/stream", handleStream);
+  server.addRoute("/api/upload", handleUpload);
+  server.setMaxBodyLength("/api/upload", 1024 * 1024);
+#else
+  server.addRoute("/api/slow", handleUnsupported);
+  server.addRoute("/api/stream", handleUnsupported);
+  server.addRoute("/api/upload", handleUnsupported);
+#endif
+}
+
+void loop() {
+  // Wakes up for new requests and for the waits of the coroutines
+  server.poll();
+}
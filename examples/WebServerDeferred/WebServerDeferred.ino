@@ -0,0 +1,113 @@
+/*
+ * ESP32 - Deferred Responses Example
+ *
+ * This example demonstrates handlers that park their request and answer it
+ * later, while the server keeps serving other clients:
+ * - GET /api/temperature starts a slow (simulated 750 ms) sensor conversion and
+ *   answers every waiting client when it is done
+ * - GET /api/counter?since=N is a long poll: it answers as soon as the counter
+ *   is above N, or with 204 No Content after 20 seconds
+ * - POST /api/counter increments the counter and wakes up the long polls
+ *
+ * Test with:
+ *   curl http://<ip>/api/temperature
+ *   curl "http://<ip>/api/counter?since=0"   (waits)
+ *   curl -X POST http://<ip>/api/counter     (from another terminal)
+ *
+ * Hardware: ESP32 Board
+ * Library: DIYables_ESP32_WebServer
+ */
+
+#include <DIYables_ESP32_WebServer.h>
+
+// WiFi credentials
+const char WIFI_SSID[] = "YOUR_WIFI_SSID";
+const char WIFI_PASSWORD[] = "YOUR_WIFI_PASSWORD";
+
+#define CONVERSION_TIME 750  // ms, e.g. a DS18B20 at 12-bit resolution
+
+// Create web server instance
+DIYables_ESP32_WebServer server;
+
+// Requests waiting for the sensor and for the counter
+DeferredResponse temperatureRequests[MAX_DEFERRED_RESPONSES];
+DeferredResponse counterRequests[MAX_DEFERRED_RESPONSES];
+bool conversionRunning = false;
+unsigned long conversionStart = 0;
+unsigned long counter = 0;
+
+// Keeps a parked request in a list, or answers at once if the server has no free slot
+bool park(DeferredResponse list[], DeferredResponse response, WiFiClient& client) {
+  if (!response.isValid()) {
+    server.sendResponse(client, "{\"error\":\"busy\"}", "application/json");
+    return false;
+  }
+  for (int i = 0; i < MAX_DEFERRED_RESPONSES; i++) {
+    if (!server.isPending(list[i])) {
+      list[i] = response;
+      return true;
+    }
+  }
+  return false;
+}
+
+void handleTemperature(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData) {
+  if (!conversionRunning) {
+    conversionRunning = true;
+    conversionStart = millis();
+  }
+  park(temperatureRequests, server.deferResponse(client, 5000), client);
+}
+
+void handleCounter(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData) {
+  char response[32];
+  if (method == "POST") {
+    counter++;
+    snprintf(response, sizeof(response), "{\"counter\":%lu}", counter);
+    // Wake up every long poll
+    for (int i = 0; i < MAX_DEFERRED_RESPONSES; i++) {
+      server.completeResponse(counterRequests[i], response, "application/json");
+    }
+    server.sendResponse(client, response, "application/json");
+    return;
+  }
+
+  unsigned long since = 0;
+  for (int i = 0; i < params.count; i++) {
+    if (String(params.params[i].key) == "since") {
+      since = strtoul(params.params[i].value, nullptr, 10);
+    }
+  }
+  if (counter > since) {
+    snprintf(response, sizeof(response), "{\"counter\":%lu}", counter);
+    server.sendResponse(client, response, "application/json");
+  } else {
+    // 204 after 20 s; the client then simply polls again
+    park(counterRequests, server.deferResponse(client, 20000, 204), client);
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Initialize web server with WiFi credentials
+  server.begin(WIFI_SSID, WIFI_PASSWORD);
+
+  // Add routes
+  server.addRoute("/api/temperature", handleTemperature);
+  server.addRoute("/api/counter", handleCounter);
+}
+
+void loop() {
+  server.handleClient();
+
+  // Conversion finished: answer everybody who asked meanwhile
+  if (conversionRunning && millis() - conversionStart >= CONVERSION_TIME) {
+    conversionRunning = false;
+    char response[32];
+    snprintf(response, sizeof(response), "{\"temperature\":%.1f}", 20.0 + random(0, 100) / 10.0);
+    for (int i = 0; i < MAX_DEFERRED_RESPONSES; i++) {
+      server.completeResponse(temperatureRequests[i], response, "application/json");
+    }
+  }
+}
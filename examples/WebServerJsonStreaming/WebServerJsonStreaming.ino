@@ -0,0 +1,148 @@
+/*
+ * ESP32 - Streaming JSON API Example
+ *
+ * This example demonstrates JSON without ArduinoJson and without building
+ * documents or response strings in RAM:
+ * - GET /api/sensors writes the response with JsonStreamWriter, straight to the client
+ * - POST /api/config parses the request body with JsonTokenizer, chunk by chunk
+ *   as it arrives, so bodies of any size are handled in a few hundred bytes
+ * - Responses of 256 bytes or more are gzip compressed for clients that accept it
+ *
+ * Test with:
+ *   curl http://<ip>/api/sensors
+ *   curl --compressed -v http://<ip>/api/sensors
+ *   curl -d '{"led":true,"interval":500,"name":"kitchen"}' http://<ip>/api/config
+ *
+ * Hardware: ESP32 Board
+ * Library: DIYables_ESP32_WebServer
+ */
+
+#include <DIYables_ESP32_WebServer.h>
+
+// WiFi credentials
+const char WIFI_SSID[] = "YOUR_WIFI_SSID";
+const char WIFI_PASSWORD[] = "YOUR_WIFI_PASSWORD";
+
+// LED configuration
+#define LED_PIN 2  // ESP32 built-in LED pin
+
+// Create web server instance
+DIYables_ESP32_WebServer server;
+
+// Device configuration, changed through POST /api/config
+bool ledOn = false;
+long interval = 1000;
+char deviceName[16] = "esp32";
+
+// Parser state for the current POST body
+char currentKey[16];
+int changedFields = 0;
+
+// Called by the tokenizer for every key and value of the body
+void onJsonEvent(JsonEvent event, const char* value, size_t length, uint8_t depth, void* context) {
+  if (depth != 1) return;  // only the fields of the top-level object
+
+  if (event == JSON_KEY) {
+    strncpy(currentKey, value, sizeof(currentKey) - 1);
+    currentKey[sizeof(currentKey) - 1] = '\0';
+  } else if (event == JSON_BOOL && strcmp(currentKey, "led") == 0) {
+    ledOn = (value[0] == 't');
+    changedFields++;
+  } else if (event == JSON_NUMBER && strcmp(currentKey, "interval") == 0) {
+    interval = atol(value);
+    changedFields++;
+  } else if (event == JSON_STRING && strcmp(currentKey, "name") == 0) {
+    strncpy(deviceName, value, sizeof(deviceName) - 1);
+    deviceName[sizeof(deviceName) - 1] = '\0';
+    changedFields++;
+  }
+}
+
+JsonTokenizer configParser(onJsonEvent);
+
+// Called by the server with each chunk of the POST body
+void handleConfigBody(const String& path, const uint8_t* data, size_t length, size_t offset, size_t total) {
+  if (offset == 0) {
+    configParser.reset();
+    currentKey[0] = '\0';
+    changedFields = 0;
+  }
+  configParser.feed((const char*)data, length);
+}
+
+void handleConfig(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData) {
+  if (method == "POST") {
+    bool valid = configParser.finish();
+    size_t errorPosition = configParser.position();
+    configParser.reset();  // a POST without a body must not see this one's state
+
+    if (!valid) {
+      server.beginResponse(client, "application/json", 400);
+      JsonStreamWriter json(client);
+      json.beginObject();
+      json.add("status", "error");
+      json.add("message", "Invalid JSON");
+      json.add("position", (unsigned long)errorPosition);
+      json.endObject();
+      return;
+    }
+    digitalWrite(LED_PIN, ledOn ? HIGH : LOW);
+  }
+
+  server.beginResponse(client, "application/json");
+  JsonStreamWriter json(client);
+  json.beginObject();
+  json.add("status", "success");
+  if (method == "POST") {
+    json.add("changed", changedFields);
+  }
+  json.key("config").beginObject();
+  json.add("led", ledOn);
+  json.add("interval", interval);
+  json.add("name", (const char*)deviceName);
+  json.endObject();
+  json.endObject();
+}
+
+void handleSensors(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData) {
+  server.beginResponse(client, "application/json");
+
+  // Each value goes out as it is written; nothing is built in RAM first
+  JsonStreamWriter json(client);
+  json.beginObject();
+  json.add("uptime", millis());
+  json.add("temperature", 23.5 + (millis() % 100) / 100.0);
+  json.key("readings").beginArray();
+  for (int i = 0; i < 8; i++) {
+    json.beginObject();
+    json.add("channel", i);
+    json.add("value", (int)analogRead(32 + (i % 8)));
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+}
+
+void setup() {
+  Serial.begin(9600);
+  pinMode(LED_PIN, OUTPUT);
+  digitalWrite(LED_PIN, LOW);
+
+  // Initialize web server with WiFi credentials
+  server.begin(WIFI_SSID, WIFI_PASSWORD);
+
+  // Add routes
+  server.addRoute("/api/sensors", handleSensors);
+  server.addRoute("/api/config", handleConfig);
+
+  // Stream the config body into the tokenizer instead of buffering it
+  server.setBodyHandler("/api/config", handleConfigBody);
+  server.setMaxBodyLength("/api/config", 65536);
+
+  // Compress responses of 256 bytes or more (about 5 KB of RAM)
+  server.enableCompression(256);
+}
+
+void loop() {
+  server.handleClient();
+}
@@ -39,18 +39,31 @@ void handleRoot(WiFiClient& client, const String& method, const String& request,
   server.sendResponse(client, LOGIN_SUCCESS_PAGE);
 }
 
+// Public status handler (no login needed, see setRouteAuth below)
+void handleStatus(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData) {
+  server.sendResponse(client, "{\"status\":\"ok\"}", "application/json");
+}
+
 void setup() {
   Serial.begin(9600);
   delay(1000);
 
   // Configure the main route
   server.addRoute("/", handleRoot);
+  server.addRoute("/status", handleStatus);
 
   // Start server with WiFi connection (handles connection automatically)
   server.begin(WIFI_SSID, WIFI_PASSWORD);
 
-  // Enable basic authentication
-  server.enableAuthentication(www_username, www_password, "esp32");
+  // Enable basic authentication (a username and password together longer than
+  // about 60 characters are refused, and every protected page then answers
+  // 401; a WebServerConfig with a larger maxAuthCredentialLength takes more)
+  if (!server.enableAuthentication(www_username, www_password, "esp32")) {
+    Serial.println("Username or password too long, nobody can log in");
+  }
+
+  // Keep the status route public; every other route still needs the login
+  server.setRouteAuth("/status", AUTH_PUBLIC);
 
   Serial.print("IP Address: ");
   Serial.println(WiFi.localIP());
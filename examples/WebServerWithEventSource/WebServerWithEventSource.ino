@@ -0,0 +1,73 @@
+/*
+ * ESP32 - Server-Sent Events Example
+ *
+ * This example demonstrates one-way push from the ESP32 to a web page:
+ * - The page at / opens an EventSource on /events (same port, no WebSocket needed)
+ * - A temperature reading is broadcast every 2 seconds as a "temperature" event
+ * - Reconnecting browsers get the events they missed (Last-Event-ID)
+ * - Idle streams are kept open with keep-alive comments
+ *
+ * Test from a terminal with:
+ *   curl -N http://<ip>/events
+ *
+ * Hardware: ESP32 Board
+ * Library: DIYables_ESP32_WebServer
+ */
+
+#include <DIYables_ESP32_WebServer.h>
+#include "events_html.h"
+
+// WiFi credentials
+const char WIFI_SSID[] = "YOUR_WIFI_SSID";
+const char WIFI_PASSWORD[] = "YOUR_WIFI_PASSWORD";
+
+// Create web server instance and event source
+DIYables_ESP32_WebServer server;
+DIYables_ESP32_EventSource events("/events");
+
+uint32_t eventId = 0;
+unsigned long lastReading = 0;
+
+void handleHome(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData) {
+  server.sendResponse(client, htmlPage);
+}
+
+// Send the current state to a new client right away
+void onEventsConnect(DIYables_ESP32_EventSource& source, uint8_t client, uint32_t lastEventId) {
+  Serial.print("Event stream opened, Last-Event-ID: ");
+  Serial.println(lastEventId);
+
+  char uptime[12];
+  snprintf(uptime, sizeof(uptime), "%lu", millis() / 1000);
+  source.sendEvent(client, 0, "uptime", uptime);
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  // Initialize web server with WiFi credentials
+  server.begin(WIFI_SSID, WIFI_PASSWORD);
+
+  // Add routes and the event source
+  server.addRoute("/", handleHome);
+  events.onConnect(onEventsConnect);
+  server.addEventSource(events);
+}
+
+void loop() {
+  // At most 100 ms asleep, so the readings below stay on time
+  server.poll(100);
+
+  if (millis() - lastReading >= 2000) {
+    lastReading = millis();
+
+    // Simulated sensor reading
+    char temperature[8];
+    snprintf(temperature, sizeof(temperature), "%.1f", 20.0 + (millis() / 1000 % 100) / 10.0);
+    events.broadcastEvent(++eventId, "temperature", temperature);
+
+    char uptime[12];
+    snprintf(uptime, sizeof(uptime), "%lu", millis() / 1000);
+    events.broadcastEvent(0, "uptime", uptime);
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef EVENTS_HTML_H
+#define EVENTS_HTML_H
+
+const char htmlPage[] PROGMEM = R"rawliteral(
+<!DOCTYPE html>
+<html lang="en">
+<head>
+<meta charset="UTF-8">
+<meta name="viewport" content="width=device-width, initial-scale=1.0">
+<title>ESP32 Server-Sent Events</title>
+<style>
+body { font-family: Arial, sans-serif; background: #f0f2f5; padding: 15px; }
+.card { max-width: 400px; margin: 0 auto; background: white; border-radius: 12px; padding: 20px; box-shadow: 0 2px 10px rgba(0,0,0,0.1); }
+.value { font-size: 40px; font-weight: bold; color: #2c3e50; }
+.status { color: #7f8c8d; font-size: 14px; }
+</style>
+</head>
+<body>
+<div class="card">
+  <h2>ESP32 Sensor</h2>
+  <div class="value"><span id="temperature">--</span> &deg;C</div>
+  <p>Uptime: <span id="uptime">--</span> s</p>
+  <p class="status" id="status">Connecting...</p>
+</div>
+<script>
+// The browser reconnects by itself and sends Last-Event-ID, so no reading is missed
+var source = new EventSource('/events');
+source.onopen = function() { document.getElementById('status').textContent = 'Connected'; };
+source.onerror = function() { document.getElementById('status').textContent = 'Reconnecting...'; };
+source.addEventListener('temperature', function(e) {
+  document.getElementById('temperature').textContent = e.data;
+});
+source.addEventListener('uptime', function(e) {
+  document.getElementById('uptime').textContent = e.data;
+});
+</script>
+</body>
+</html>
+)rawliteral";
+
+#endif
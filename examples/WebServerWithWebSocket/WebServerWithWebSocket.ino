@@ -108,8 +108,9 @@ void setup() {
   Serial.println("Connecting to WiFi...");
   server.begin(WIFI_SSID, WIFI_PASSWORD);
   
-  // Enable WebSocket functionality
-  webSocket = server.enableWebSocket(81);
+  // Enable WebSocket on the web server's port, at ws://<ip>/ws
+  // (server.enableWebSocket(81) would open a separate port instead)
+  webSocket = server.enableWebSocket("/ws");
   
   if (webSocket != nullptr) {
     // Set up WebSocket event handlers
@@ -117,7 +118,7 @@ void setup() {
     webSocket->onMessage(onWebSocketMessage);
     webSocket->onClose(onWebSocketClose);
     
-    Serial.println("WebSocket server started on port 81");
+    Serial.println("WebSocket server started on /ws");
   } else {
     Serial.println("Failed to start WebSocket server");
   }
@@ -127,16 +128,12 @@ void setup() {
   Serial.println(WiFi.localIP());
   Serial.print("WebSocket: ws://");
   Serial.print(WiFi.localIP());
-  Serial.println(":81");
+  Serial.println("/ws");
   Serial.println("Commands: ping, hello, time, led on, led off");
 } 
  
 void loop() {
-  // Handle WebSocket first (high priority for real-time communication)
-  server.handleWebSocket();
-  
-  // Then handle HTTP requests
-  server.handleClient();
-  
-  // No delay - process as fast as possible for responsive WebSocket
+  // Sleeps until a WebSocket or HTTP client needs attention, then serves it;
+  // the core stays idle instead of spinning between requests
+  server.poll();
 }
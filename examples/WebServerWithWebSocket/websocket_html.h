@@ -257,7 +257,7 @@ button {
 <script>
 var ws = null;
 var connected = false;
-var wsUrl = 'ws://' + window.location.hostname + ':81';
+var wsUrl = 'ws://' + window.location.host + '/ws';
 
 function toggleConnection() {
   connected ? disconnect() : connect();
@@ -0,0 +1,206 @@
+/*
+ * bench_util.cpp
+ */
+
+#include "bench_util.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace bench {
+
+uint64_t nowNanos() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+//
+// Sockets:
+//
+
+int connectTcp(const char *host, uint16_t port) {
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+    hostent *entry = gethostbyname(host);
+    if (!entry || entry->h_addrtype != AF_INET) return -1;
+    memcpy(&addr.sin_addr, entry->h_addr_list[0], sizeof(addr.sin_addr));
+  }
+
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  const int enable = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+  return fd;
+}
+
+void setSocketTimeout(int fd, uint32_t ms) {
+  timeval tv{};
+  tv.tv_sec = ms / 1000;
+  tv.tv_usec = (ms % 1000) * 1000;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool sendAll(int fd, const void *data, size_t size) {
+  auto *bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    const ssize_t n = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool recvAll(int fd, void *data, size_t size) {
+  auto *bytes = static_cast<uint8_t *>(data);
+  while (size > 0) {
+    const ssize_t n = recv(fd, bytes, size, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    bytes += n;
+    size -= n;
+  }
+  return true;
+}
+
+//
+// Command line:
+//
+
+std::vector<uint32_t> parseNumberList(const char *list) {
+  std::vector<uint32_t> numbers;
+  while (*list) {
+    char *end = nullptr;
+    const unsigned long value = strtoul(list, &end, 10);
+    if (end == list) break;
+    numbers.push_back(static_cast<uint32_t>(value));
+    list = (*end == ',') ? end + 1 : end;
+  }
+  return numbers;
+}
+
+std::vector<std::string> parseNameList(const char *list) {
+  std::vector<std::string> names;
+  std::string current;
+  for (const char *p = list;; ++p) {
+    if (*p == ',' || *p == '\0') {
+      if (!current.empty()) names.push_back(current);
+      current.clear();
+      if (*p == '\0') break;
+    } else {
+      current += *p;
+    }
+  }
+  return names;
+}
+
+bool contains(const std::vector<std::string> &names, const char *name) {
+  return std::find(names.begin(), names.end(), name) != names.end();
+}
+
+//
+// LatencyRecorder:
+//
+
+void LatencyRecorder::merge(const LatencyRecorder &other) {
+  m_samples.insert(
+    m_samples.end(), other.m_samples.begin(), other.m_samples.end());
+  m_sorted = false;
+}
+
+double LatencyRecorder::percentileMicros(double percentile) {
+  if (m_samples.empty()) return 0;
+  if (!m_sorted) {
+    std::sort(m_samples.begin(), m_samples.end());
+    m_sorted = true;
+  }
+  // Nearest-rank: smallest sample with at least `percentile` % at or below it
+  size_t rank =
+    static_cast<size_t>(std::ceil(percentile / 100.0 * m_samples.size()));
+  if (rank == 0) rank = 1;
+  return m_samples[std::min(rank, m_samples.size()) - 1] / 1000.0;
+}
+
+double LatencyRecorder::meanMicros() const {
+  if (m_samples.empty()) return 0;
+  double sum = 0;
+  for (const auto sample : m_samples) sum += sample;
+  return sum / m_samples.size() / 1000.0;
+}
+
+double LatencyRecorder::maxMicros() const {
+  if (m_samples.empty()) return 0;
+  return *std::max_element(m_samples.begin(), m_samples.end()) / 1000.0;
+}
+
+//
+// JsonLine:
+//
+
+void JsonLine::_key(const char *key) {
+  m_text += m_text.empty() ? "{\"" : ",\"";
+  m_text += key;
+  m_text += "\":";
+}
+
+JsonLine &JsonLine::add(const char *key, const char *value) {
+  _key(key);
+  m_text += '"';
+  for (const char *p = value; *p; ++p) {
+    if (*p == '"' || *p == '\\') m_text += '\\';
+    m_text += *p;
+  }
+  m_text += '"';
+  return *this;
+}
+
+JsonLine &JsonLine::add(const char *key, double value) {
+  char number[32];
+  snprintf(number, sizeof(number), "%.3f", std::isfinite(value) ? value : 0.0);
+  _key(key);
+  m_text += number;
+  return *this;
+}
+
+JsonLine &JsonLine::add(const char *key, uint64_t value) {
+  _key(key);
+  m_text += std::to_string(value);
+  return *this;
+}
+
+JsonLine &JsonLine::addLatency(const char *prefix, LatencyRecorder &latency) {
+  const std::string name{prefix};
+  add((name + "_p50_us").c_str(), latency.percentileMicros(50));
+  add((name + "_p99_us").c_str(), latency.percentileMicros(99));
+  add((name + "_p999_us").c_str(), latency.percentileMicros(99.9));
+  add((name + "_mean_us").c_str(), latency.meanMicros());
+  add((name + "_max_us").c_str(), latency.maxMicros());
+  return *this;
+}
+
+void JsonLine::print(FILE *out) const {
+  fputs(m_text.empty() ? "{}" : m_text.c_str(), out);
+  fputs(m_text.empty() ? "\n" : "}\n", out);
+  fflush(out);
+}
+
+} // namespace bench
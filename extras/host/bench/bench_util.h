@@ -0,0 +1,99 @@
+/*
+ * bench_util.h
+ *
+ * Shared helpers for the host benchmarks: monotonic clock, blocking TCP
+ * client sockets, latency percentiles, command line lists and JSON Lines
+ * output (one object per result, easy to diff between releases).
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/** @return Monotonic time in nanoseconds. */
+uint64_t nowNanos();
+
+/** @brief Keeps the compiler from optimizing away a benchmarked result. */
+template <typename T> inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+/** @brief Forces pending writes to memory to be considered observable. */
+inline void clobberMemory() { asm volatile("" : : : "memory"); }
+
+/**
+ * @brief Opens a blocking TCP connection with TCP_NODELAY set.
+ * @return Socket descriptor or -1.
+ */
+int connectTcp(const char *host, uint16_t port);
+/** @brief Applies SO_RCVTIMEO/SO_SNDTIMEO so a stuck server fails the run. */
+void setSocketTimeout(int fd, uint32_t ms);
+/** @return false if the peer closed or the write failed. */
+bool sendAll(int fd, const void *data, size_t size);
+/** @return false if the peer closed or the read failed / timed out. */
+bool recvAll(int fd, void *data, size_t size);
+
+/** @brief Parses "1,4,16" into {1, 4, 16}. */
+std::vector<uint32_t> parseNumberList(const char *list);
+/** @brief Parses "static,json" into {"static", "json"}. */
+std::vector<std::string> parseNameList(const char *list);
+bool contains(const std::vector<std::string> &names, const char *name);
+
+/** @brief Latency samples (in nanoseconds) with nearest-rank percentiles. */
+class LatencyRecorder {
+public:
+  void reserve(size_t n) { m_samples.reserve(n); }
+  void add(uint64_t nanos) { m_samples.push_back(nanos); }
+  void merge(const LatencyRecorder &other);
+  size_t count() const { return m_samples.size(); }
+
+  /** @remark Sorts the samples; call after recording is done. */
+  double percentileMicros(double percentile);
+  double meanMicros() const;
+  double maxMicros() const;
+
+private:
+  std::vector<uint64_t> m_samples;
+  bool m_sorted{false};
+};
+
+/**
+ * @brief Builds one JSON object and prints it as a single line.
+ * @code
+ * JsonLine line;
+ * line.add("suite", "http").add("rps", 1234.5);
+ * line.print(stdout);
+ * @endcode
+ */
+class JsonLine {
+public:
+  JsonLine &add(const char *key, const char *value);
+  JsonLine &add(const char *key, const std::string &value) {
+    return add(key, value.c_str());
+  }
+  JsonLine &add(const char *key, double value);
+  JsonLine &add(const char *key, uint64_t value);
+  JsonLine &add(const char *key, uint32_t value) {
+    return add(key, static_cast<uint64_t>(value));
+  }
+  JsonLine &add(const char *key, int value) {
+    return add(key, static_cast<uint64_t>(value < 0 ? 0 : value));
+  }
+  /** @brief Adds p50/p99/p999/mean/max in microseconds. */
+  JsonLine &addLatency(const char *prefix, LatencyRecorder &latency);
+
+  void print(FILE *out) const;
+
+private:
+  void _key(const char *key);
+
+  std::string m_text;
+};
+
+} // namespace bench
@@ -0,0 +1,303 @@
+/*
+ * http_bench.cpp
+ *
+ * HTTP throughput/latency benchmark for the host build.
+ *
+ * Starts two DIYables_ESP32_WebServer instances in a background thread (the
+ * second one with Basic authentication enabled) and drives them over
+ * loopback with a bundled closed-loop load generator: each worker opens a
+ * connection, sends one request, reads the response until the server closes
+ * and starts over. Every (scenario, concurrency) pair is printed as one JSON
+ * line on stdout; a readable table goes to stderr.
+ *
+ * Scenarios:
+ *   static  GET /            fixed HTML page through sendResponse()
+ *   query   GET /query?...   three query parameters, formatted response
+ *   auth    GET /secure      same page on the server with authentication
+ *   json    POST /api        small JSON body echoed back as JSON
+ *
+ * Usage:
+ *   http_bench [--duration ms] [--warmup ms] [--concurrency 1,4,16]
+ *              [--scenarios static,query,auth,json] [--port 18080]
+ *              [--label text] [--target host] [--serve]
+ *
+ *   --target host  benchmark servers already running elsewhere (for example
+ *                  `http_bench --serve` under perf or valgrind)
+ *   --serve        only run the servers, in the foreground
+ */
+
+#include "bench_util.h"
+
+#include <DIYables_ESP32_WebServer.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+constexpr const char *kAuthUser{"bench"};
+constexpr const char *kAuthPassword{"secret"};
+constexpr const char *kAuthHeader{"YmVuY2g6c2VjcmV0"}; // bench:secret
+
+const char kStaticPage[] =
+  "<!DOCTYPE html><html><head><title>ESP32 Web Server</title>"
+  "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">"
+  "<style>body{font-family:Arial,sans-serif;margin:40px;background:#f4f4f4}"
+  ".card{background:#fff;padding:20px;border-radius:8px;max-width:480px}"
+  "a{display:block;margin:8px 0;color:#0366d6}</style></head><body>"
+  "<div class=\"card\"><h1>ESP32 Web Server</h1>"
+  "<p>Welcome! This page is served by the benchmark route.</p>"
+  "<a href=\"/temperature\">Temperature</a><a href=\"/led\">LED control</a>"
+  "<a href=\"/query?unit=C\">Query strings</a></div></body></html>";
+
+const char kJsonBody[] =
+  "{\"sensor\":\"temperature\",\"value\":23.5,\"unit\":\"C\","
+  "\"timestamp\":1234567890,\"tags\":[\"kitchen\",\"ground-floor\"]}";
+
+DIYables_ESP32_WebServer *publicServer{nullptr};
+DIYables_ESP32_WebServer *authServer{nullptr};
+std::atomic<bool> serversRunning{false};
+
+void handleStatic(WiFiClient &client, const String &, const String &,
+  const QueryParams &, const String &) {
+  publicServer->sendResponse(client, kStaticPage);
+}
+
+void handleSecure(WiFiClient &client, const String &, const String &,
+  const QueryParams &, const String &) {
+  authServer->sendResponse(client, kStaticPage);
+}
+
+void handleQuery(WiFiClient &client, const String &, const String &,
+  const QueryParams &params, const String &) {
+  char page[256];
+  int length = snprintf(page, sizeof(page), "<html><body><ul>");
+  for (int i = 0; i < params.count; i++) {
+    length += snprintf(page + length, sizeof(page) - length,
+      "<li>%s = %s</li>", params.params[i].key, params.params[i].value);
+  }
+  snprintf(page + length, sizeof(page) - length, "</ul></body></html>");
+  publicServer->sendResponse(client, page);
+}
+
+void handleJson(WiFiClient &client, const String &method, const String &,
+  const QueryParams &, const String &jsonData) {
+  char response[96];
+  snprintf(response, sizeof(response),
+    "{\"status\":\"ok\",\"method\":\"%s\",\"received\":%u}", method.c_str(),
+    jsonData.length());
+  publicServer->sendResponse(client, response, "application/json");
+}
+
+void startServers(uint16_t port) {
+  publicServer = new DIYables_ESP32_WebServer(port);
+  publicServer->addRoute("/", handleStatic);
+  publicServer->addRoute("/query", handleQuery);
+  publicServer->addRoute("/api", handleJson);
+  publicServer->begin();
+
+  authServer = new DIYables_ESP32_WebServer(port + 1);
+  authServer->addRoute("/secure", handleSecure);
+  authServer->enableAuthentication(kAuthUser, kAuthPassword);
+  authServer->begin();
+  serversRunning = true;
+}
+
+void pollServers() {
+  while (serversRunning) {
+    publicServer->handleClient();
+    authServer->handleClient();
+  }
+}
+
+//
+// Load generator:
+//
+
+struct Scenario {
+  const char *name;
+  uint16_t portOffset; // 0 = public server, 1 = authenticated server
+  std::string request;
+};
+
+std::vector<Scenario> buildScenarios() {
+  const std::string common{
+    "Host: bench\r\nUser-Agent: http_bench\r\nAccept: */*\r\n"};
+  std::string json{"POST /api HTTP/1.1\r\n" + common +
+                   "Content-Type: application/json\r\nContent-Length: " +
+                   std::to_string(sizeof(kJsonBody) - 1) + "\r\n\r\n" +
+                   kJsonBody};
+  return {
+    {"static", 0, "GET / HTTP/1.1\r\n" + common + "\r\n"},
+    {"query", 0,
+      "GET /query?unit=C&led=on&value=42 HTTP/1.1\r\n" + common + "\r\n"},
+    {"auth", 1,
+      "GET /secure HTTP/1.1\r\n" + common + "Authorization: Basic " +
+        kAuthHeader + "\r\n\r\n"},
+    {"json", 0, json},
+  };
+}
+
+struct WorkerResult {
+  bench::LatencyRecorder latency;
+  uint64_t errors{0};
+  uint64_t bytesIn{0};
+};
+
+/** @return Response size, or -1 on failure / non-200 status. */
+int64_t runRequest(const char *host, uint16_t port, const std::string &request) {
+  const int fd = bench::connectTcp(host, port);
+  if (fd < 0) return -1;
+  bench::setSocketTimeout(fd, 5000);
+
+  int64_t total{-1};
+  if (bench::sendAll(fd, request.data(), request.size())) {
+    char buffer[4096];
+    bool ok{false};
+    total = 0;
+    for (;;) {
+      const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        if (n < 0) ok = false; // timeout or reset
+        break;
+      }
+      if (total == 0) ok = n >= 12 && memcmp(buffer + 9, "200", 3) == 0;
+      total += n;
+    }
+    if (!ok) total = -1;
+  }
+  close(fd);
+  return total;
+}
+
+void runWorker(const char *host, uint16_t port, const std::string &request,
+  uint64_t measureFrom, uint64_t deadline, WorkerResult &result) {
+  for (;;) {
+    const uint64_t start{bench::nowNanos()};
+    if (start >= deadline) break;
+    const int64_t size = runRequest(host, port, request);
+    const uint64_t end{bench::nowNanos()};
+    if (start < measureFrom) continue; // warm-up
+
+    if (size < 0) {
+      ++result.errors;
+    } else {
+      result.latency.add(end - start);
+      result.bytesIn += size;
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  uint32_t durationMs{2000};
+  uint32_t warmupMs{250};
+  uint16_t port{18080};
+  const char *target{nullptr};
+  const char *label{""};
+  bool serveOnly{false};
+  std::vector<uint32_t> concurrencies{1, 4, 16};
+  std::vector<std::string> selected{"static", "query", "auth", "json"};
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+    if (!strcmp(arg, "--duration")) {
+      durationMs = atoi(value), ++i;
+    } else if (!strcmp(arg, "--warmup")) {
+      warmupMs = atoi(value), ++i;
+    } else if (!strcmp(arg, "--concurrency")) {
+      concurrencies = bench::parseNumberList(value), ++i;
+    } else if (!strcmp(arg, "--scenarios")) {
+      selected = bench::parseNameList(value), ++i;
+    } else if (!strcmp(arg, "--port")) {
+      port = atoi(value), ++i;
+    } else if (!strcmp(arg, "--target")) {
+      target = value, ++i;
+    } else if (!strcmp(arg, "--label")) {
+      label = value, ++i;
+    } else if (!strcmp(arg, "--serve")) {
+      serveOnly = true;
+    } else {
+      fprintf(stderr, "unknown option: %s\n", arg);
+      return 2;
+    }
+  }
+
+  // The server's request logging would dominate the measurement
+  setenv("HOST_SERIAL", "0", 0);
+
+  std::thread serverThread;
+  if (!target) {
+    startServers(port);
+    if (serveOnly) {
+      fprintf(stderr, "serving on ports %u (public) and %u (auth)\n", port,
+        port + 1);
+      pollServers();
+      return 0;
+    }
+    serverThread = std::thread{pollServers};
+    target = "127.0.0.1";
+  }
+
+  fprintf(stderr, "%-8s %5s %10s %8s %10s %10s %10s %10s\n", "scenario",
+    "conc", "requests", "errors", "req/s", "p50 us", "p99 us", "p999 us");
+
+  for (const auto &scenario : buildScenarios()) {
+    if (!bench::contains(selected, scenario.name)) continue;
+
+    for (const auto concurrency : concurrencies) {
+      if (concurrency == 0) continue;
+      const uint64_t begin{bench::nowNanos()};
+      const uint64_t measureFrom{begin + warmupMs * 1000000ull};
+      const uint64_t deadline{measureFrom + durationMs * 1000000ull};
+
+      std::vector<WorkerResult> results(concurrency);
+      std::vector<std::thread> workers;
+      for (uint32_t i = 0; i < concurrency; i++) {
+        workers.emplace_back(runWorker, target, port + scenario.portOffset,
+          std::cref(scenario.request), measureFrom, deadline,
+          std::ref(results[i]));
+      }
+      for (auto &worker : workers) worker.join();
+
+      WorkerResult total;
+      for (const auto &result : results) {
+        total.latency.merge(result.latency);
+        total.errors += result.errors;
+        total.bytesIn += result.bytesIn;
+      }
+      const double seconds{durationMs / 1000.0};
+      const double rps{total.latency.count() / seconds};
+
+      bench::JsonLine line;
+      line.add("suite", "http")
+        .add("label", label)
+        .add("scenario", scenario.name)
+        .add("concurrency", concurrency)
+        .add("duration_s", seconds)
+        .add("requests", static_cast<uint64_t>(total.latency.count()))
+        .add("errors", total.errors)
+        .add("rps", rps)
+        .add("bytes_in", total.bytesIn)
+        .addLatency("latency", total.latency);
+      line.print(stdout);
+
+      fprintf(stderr, "%-8s %5u %10zu %8llu %10.1f %10.1f %10.1f %10.1f\n",
+        scenario.name, concurrency, total.latency.count(),
+        static_cast<unsigned long long>(total.errors), rps,
+        total.latency.percentileMicros(50), total.latency.percentileMicros(99),
+        total.latency.percentileMicros(99.9));
+    }
+  }
+
+  if (serverThread.joinable()) {
+    serversRunning = false;
+    serverThread.join();
+  }
+  return 0;
+}
@@ -0,0 +1,261 @@
+/*
+ * micro_bench.cpp
+ *
+ * Microbenchmarks for the parsing and crypto primitives on the request and
+ * frame paths: base64_encode/base64_decode, SHA1 update+finalize,
+ * isValidUTF8, parseQueryString, encodeSecKey, the WebSocket XOR mask and
+ * gzip response compression (DeflateEncoder).
+ *
+ * Each primitive runs over a range of input sizes. The iteration count is
+ * calibrated so one sample takes about --min-time ms; the median of
+ * --repeat samples is reported as ns/op and ns/byte, one JSON line per
+ * (primitive, size) on stdout and as a table on stderr.
+ *
+ * Usage:
+ *   micro_bench [--sizes 16,64,256,1024,4096] [--min-time 50] [--repeat 5]
+ *               [--filter base64_encode,sha1] [--label text]
+ *
+ * For "deflate" the compression ratio is printed to stderr as well.
+ */
+
+#include "bench_util.h"
+
+#include <DIYables_ESP32_WebServer.h>
+
+#include "CryptoLegacy/SHA1.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+struct Options {
+  std::vector<uint32_t> sizes{16, 64, 256, 1024, 4096};
+  uint32_t minTimeMs{50};
+  uint32_t repeat{5};
+  std::vector<std::string> filter;
+  const char *label{""};
+};
+
+/** @return Median ns per call of body(). */
+double measure(const std::function<void()> &body, const Options &options) {
+  // Grow the batch until it runs for at least a tenth of the target time
+  uint64_t iterations{1};
+  for (;;) {
+    const uint64_t start{bench::nowNanos()};
+    for (uint64_t i = 0; i < iterations; i++) body();
+    const uint64_t elapsed{bench::nowNanos() - start};
+    if (elapsed >= options.minTimeMs * 100000ull || iterations >= (1ull << 40))
+      break;
+    iterations *= (elapsed < options.minTimeMs * 10000ull) ? 10 : 2;
+  }
+  iterations = std::max<uint64_t>(1, iterations * 10);
+
+  std::vector<double> samples;
+  for (uint32_t r = 0; r < std::max<uint32_t>(1, options.repeat); r++) {
+    const uint64_t start{bench::nowNanos()};
+    for (uint64_t i = 0; i < iterations; i++) body();
+    samples.push_back(static_cast<double>(bench::nowNanos() - start) / iterations);
+  }
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+void report(const Options &options, const char *name, size_t bytes,
+  double nsPerOp) {
+  bench::JsonLine line;
+  line.add("suite", "micro")
+    .add("label", options.label)
+    .add("name", name)
+    .add("bytes", static_cast<uint64_t>(bytes))
+    .add("ns_per_op", nsPerOp)
+    .add("ns_per_byte", bytes ? nsPerOp / bytes : 0.0)
+    .add("mb_per_s", nsPerOp > 0 ? bytes * 1000.0 / nsPerOp : 0.0);
+  line.print(stdout);
+  fprintf(stderr, "%-20s %7zu %12.1f %10.3f\n", name, bytes, nsPerOp,
+    bytes ? nsPerOp / bytes : 0.0);
+}
+
+/** @brief Print that only counts, so the compressor is measured alone. */
+class NullPrint : public Print {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *, size_t size) override { return size; }
+  using Print::write;
+};
+
+bool selected(const Options &options, const char *name) {
+  return options.filter.empty() || bench::contains(options.filter, name);
+}
+
+/** @brief Deterministic printable text (what HTTP/WebSocket payloads are). */
+std::string makeText(size_t size) {
+  static const char kWords[] =
+    "{\"temperature\":23.5,\"humidity\":41,\"led\":\"on\",\"uptime\":12345} ";
+  std::string text;
+  while (text.size() < size) text += kWords;
+  text.resize(size);
+  return text;
+}
+
+/** @brief Text with 2, 3 and 4 byte UTF-8 sequences mixed into ASCII. */
+std::string makeUtf8(size_t size) {
+  static const char *kPieces[]{"temp ", "\xc2\xb0" "C ", "\xe2\x82\xac ",
+    "\xf0\x9f\x8c\xa1 ", "ok "};
+  std::string text;
+  for (size_t i = 0; text.size() < size; i++) {
+    const std::string piece{kPieces[i % 5]};
+    if (text.size() + piece.size() > size) break;
+    text += piece;
+  }
+  while (text.size() < size) text += ' ';
+  return text;
+}
+
+/** @brief "/page?k0=value&k1=value..." of about `size` bytes. */
+String makeQuery(size_t size) {
+  std::string query{"/page?"};
+  for (int i = 0; query.size() < size; i++) {
+    if (i > 0) query += '&';
+    query += "k" + std::to_string(i) + "=value" + std::to_string(i);
+  }
+  query.resize(std::max<size_t>(size, 7));
+  return String{query.c_str()};
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+    if (!strcmp(arg, "--sizes")) {
+      options.sizes = bench::parseNumberList(value), ++i;
+    } else if (!strcmp(arg, "--min-time")) {
+      options.minTimeMs = atoi(value), ++i;
+    } else if (!strcmp(arg, "--repeat")) {
+      options.repeat = atoi(value), ++i;
+    } else if (!strcmp(arg, "--filter")) {
+      options.filter = bench::parseNameList(value), ++i;
+    } else if (!strcmp(arg, "--label")) {
+      options.label = value, ++i;
+    } else {
+      fprintf(stderr, "unknown option: %s\n", arg);
+      return 2;
+    }
+  }
+
+  fprintf(stderr, "%-20s %7s %12s %10s\n", "name", "bytes", "ns/op",
+    "ns/byte");
+
+  for (const auto size : options.sizes) {
+    if (size == 0) continue;
+    const std::string text{makeText(size)};
+
+    if (selected(options, "base64_encode")) {
+      std::vector<char> input(text.begin(), text.end());
+      std::vector<char> output(base64_enc_len(size) + 1);
+      report(options, "base64_encode", size, measure([&] {
+        bench::doNotOptimize(base64_encode(output.data(), input.data(), size));
+        bench::clobberMemory();
+      }, options));
+    }
+
+    if (selected(options, "base64_decode")) {
+      std::vector<char> input(text.begin(), text.end());
+      std::vector<char> encoded(base64_enc_len(size) + 1);
+      const int encodedLength = base64_encode(encoded.data(), input.data(), size);
+      std::vector<char> output(size + 3);
+      report(options, "base64_decode", encodedLength, measure([&] {
+        bench::doNotOptimize(
+          base64_decode(output.data(), encoded.data(), encodedLength));
+        bench::clobberMemory();
+      }, options));
+    }
+
+    if (selected(options, "sha1")) {
+      uint8_t digest[20];
+      report(options, "sha1", size, measure([&] {
+        SHA1 sha1;
+        sha1.update(text.data(), size);
+        sha1.finalize(digest, sizeof(digest));
+        bench::doNotOptimize(digest);
+      }, options));
+    }
+
+    if (selected(options, "utf8_ascii")) {
+      const auto *bytes = reinterpret_cast<const byte *>(text.data());
+      report(options, "utf8_ascii", size, measure([&] {
+        bench::doNotOptimize(net::isValidUTF8(bytes, size));
+      }, options));
+    }
+
+    if (selected(options, "utf8_mixed")) {
+      const std::string utf8{makeUtf8(size)};
+      const auto *bytes = reinterpret_cast<const byte *>(utf8.data());
+      report(options, "utf8_mixed", size, measure([&] {
+        bench::doNotOptimize(net::isValidUTF8(bytes, size));
+      }, options));
+    }
+
+    if (selected(options, "mask")) {
+      std::vector<char> payload(text.begin(), text.end());
+      const char key[4]{0x12, 0x34, 0x56, 0x78};
+      report(options, "mask", size, measure([&] {
+        net::maskData(payload.data(), size, key);
+        bench::clobberMemory();
+      }, options));
+    }
+
+    if (selected(options, "mask_unaligned")) {
+      // Payload that does not start on a word boundary, as in a receive buffer
+      std::vector<char> buffer(size + 1);
+      memcpy(buffer.data() + 1, text.data(), size);
+      const char key[4]{0x12, 0x34, 0x56, 0x78};
+      report(options, "mask_unaligned", size, measure([&] {
+        net::maskData(buffer.data() + 1, size, key);
+        bench::clobberMemory();
+      }, options));
+    }
+
+    if (selected(options, "deflate")) {
+      static DeflateEncoder encoder;
+      encoder.allocate();
+      NullPrint sink;
+      const auto *bytes = reinterpret_cast<const uint8_t *>(text.data());
+      const double nsPerOp{measure([&] {
+        encoder.begin(sink, DEFLATE_GZIP);
+        encoder.write(bytes, size);
+        encoder.finish();
+      }, options)};
+      report(options, "deflate", size, nsPerOp);
+      encoder.begin(sink, DEFLATE_GZIP);
+      encoder.write(bytes, size);
+      encoder.finish();
+      fprintf(stderr, "%-20s %7zu   ratio %.3f\n", "", size,
+        static_cast<double>(encoder.totalOut()) / size);
+    }
+
+    // Query strings longer than the request line limit make no sense
+    if (selected(options, "parse_query") && size <= 1024) {
+      const String path{makeQuery(size)};
+      QueryParams params;
+      report(options, "parse_query", path.length(), measure([&] {
+        DIYables_ESP32_WebServer::parseQueryString(path, params);
+        bench::doNotOptimize(params);
+      }, options));
+    }
+  }
+
+  if (selected(options, "encode_sec_key")) {
+    const char key[]{"dGhlIHNhbXBsZSBub25jZQ=="};
+    char accept[29]{};
+    report(options, "encode_sec_key", 24, measure([&] {
+      net::encodeSecKey(key, accept);
+      bench::doNotOptimize(accept);
+    }, options));
+  }
+
+  return 0;
+}
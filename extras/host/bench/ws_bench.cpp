@@ -0,0 +1,386 @@
+/*
+ * ws_bench.cpp
+ *
+ * WebSocket fan-out and frame-rate benchmark for the host build.
+ *
+ * Runs DIYables_ESP32_WebSocket in a background thread, connects N local
+ * clients and, for every (client count, payload size) pair, measures:
+ *
+ *   inbound    frames/s the server reads and dispatches while every client
+ *              streams text frames as fast as TCP lets it
+ *   echo       round-trip time of a frame echoed back by onMessage
+ *   broadcast  delay from broadcastTXT() to each client receiving the frame
+ *              ("delivery") and until the last client has it ("fanout")
+ *
+ * Results are printed as one JSON line per pair on stdout and as a table on
+ * stderr. Payloads are limited by kBufferMaxSize and clients by
+ * kMaxConnections.
+ *
+ * Usage:
+ *   ws_bench [--clients 1,2,4,8] [--sizes 32,64,128,250] [--duration ms]
+ *            [--broadcasts n] [--phases inbound,echo,broadcast]
+ *            [--port 18090] [--label text]
+ */
+
+#include "bench_util.h"
+
+#include <DIYables_ESP32_WebServer.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace {
+
+constexpr uint8_t kTextFrame{0x1};
+constexpr uint8_t kCloseFrame{0x8};
+/** 'B' + 16 hex digits of the send timestamp. */
+constexpr size_t kBroadcastHeader{17};
+constexpr int kClientSendBuffer{16 * 1024};
+
+DIYables_ESP32_WebSocket *webSocket{nullptr};
+std::atomic<bool> serverRunning{true};
+std::atomic<uint64_t> framesReceived{0};
+std::atomic<int> openClients{0};
+/** Payload size requested by the main thread, 0 when none is pending. */
+std::atomic<size_t> broadcastRequest{0};
+
+//
+// Server side (runs only on the server thread):
+//
+
+void onOpen(net::WebSocket &) { ++openClients; }
+void onClose(net::WebSocket &, const net::WebSocket::CloseCode, const char *,
+  uint16_t) {
+  --openClients;
+}
+void onMessage(net::WebSocket &ws, const net::WebSocket::DataType dataType,
+  const char *message, uint16_t length) {
+  ++framesReceived;
+  if (length > 0 && message[0] == 'E') ws.send(dataType, message, length);
+}
+
+void runServer() {
+  char payload[1024];
+  while (serverRunning) {
+    webSocket->loop();
+
+    const size_t size = broadcastRequest.load();
+    if (size > 0 && size < sizeof(payload)) {
+      memset(payload, 'x', size);
+      snprintf(payload, kBroadcastHeader + 1, "B%016llx",
+        static_cast<unsigned long long>(bench::nowNanos()));
+      payload[kBroadcastHeader] = size > kBroadcastHeader ? 'x' : '\0';
+      payload[size] = '\0';
+      webSocket->broadcastTXT(payload);
+      broadcastRequest = 0;
+    }
+  }
+}
+
+//
+// Minimal client:
+//
+
+class Client {
+public:
+  Client() = default;
+  Client(const Client &) = delete;
+  ~Client() { disconnect(); }
+
+  bool connect(uint16_t port) {
+    m_fd = bench::connectTcp("127.0.0.1", port);
+    if (m_fd < 0) return false;
+    bench::setSocketTimeout(m_fd, 5000);
+    // Keeps the inbound backlog (and the time to drain it) bounded
+    const int sendBuffer{kClientSendBuffer};
+    setsockopt(m_fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+
+    static const char kRequest[] =
+      "GET / HTTP/1.1\r\nHost: bench\r\nUpgrade: websocket\r\n"
+      "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+      "Sec-WebSocket-Version: 13\r\n\r\n";
+    if (!bench::sendAll(m_fd, kRequest, sizeof(kRequest) - 1)) return false;
+
+    // Response headers end with an empty line
+    std::string response;
+    char c;
+    while (response.size() < 1024 &&
+           (response.size() < 4 ||
+             response.compare(response.size() - 4, 4, "\r\n\r\n") != 0)) {
+      if (!bench::recvAll(m_fd, &c, 1)) return false;
+      response += c;
+    }
+    return response.compare(9, 3, "101") == 0;
+  }
+
+  void disconnect() {
+    if (m_fd < 0) return;
+    const char code[2]{0x03, static_cast<char>(0xE8)}; // 1000
+    sendFrame(kCloseFrame, code, sizeof(code));
+    // Wait for the server's close frame (or the socket closing)
+    std::string payload;
+    uint8_t opcode;
+    bench::setSocketTimeout(m_fd, 500);
+    while (readFrame(opcode, payload) && opcode != kCloseFrame) {
+    }
+    close(m_fd);
+    m_fd = -1;
+  }
+
+  /** @brief Sends one masked frame with a single write. */
+  bool sendFrame(uint8_t opcode, const char *data, size_t length) {
+    uint8_t frame[14 + 1024];
+    if (length > 1024) return false;
+    size_t offset{0};
+    frame[offset++] = 0x80 | opcode;
+    if (length < 126) {
+      frame[offset++] = 0x80 | length;
+    } else {
+      frame[offset++] = 0x80 | 126;
+      frame[offset++] = length >> 8;
+      frame[offset++] = length & 0xFF;
+    }
+    const uint8_t mask[4]{0x12, 0x34, 0x56, 0x78};
+    memcpy(frame + offset, mask, 4);
+    offset += 4;
+    for (size_t i = 0; i < length; i++)
+      frame[offset + i] = data[i] ^ mask[i % 4];
+    return bench::sendAll(m_fd, frame, offset + length);
+  }
+
+  bool readFrame(uint8_t &opcode, std::string &payload) {
+    uint8_t header[2];
+    if (!bench::recvAll(m_fd, header, 2)) return false;
+    opcode = header[0] & 0x0F;
+    uint64_t length = header[1] & 0x7F;
+    if (length == 126) {
+      uint8_t extended[2];
+      if (!bench::recvAll(m_fd, extended, 2)) return false;
+      length = (extended[0] << 8) | extended[1];
+    } else if (length == 127) {
+      uint8_t extended[8];
+      if (!bench::recvAll(m_fd, extended, 8)) return false;
+      length = 0;
+      for (int i = 0; i < 8; i++) length = (length << 8) | extended[i];
+    }
+    payload.resize(length);
+    return length == 0 || bench::recvAll(m_fd, &payload[0], length);
+  }
+
+  int fd() const { return m_fd; }
+
+private:
+  int m_fd{-1};
+};
+
+bool waitFor(const std::function<bool()> &condition, uint32_t timeoutMs) {
+  const uint64_t deadline{bench::nowNanos() + timeoutMs * 1000000ull};
+  while (!condition()) {
+    if (bench::nowNanos() > deadline) return false;
+    usleep(200);
+  }
+  return true;
+}
+
+//
+// Phases:
+//
+
+/** @return Frames per second dispatched by the server. */
+double runInbound(std::vector<Client> &clients, size_t size, uint32_t durationMs) {
+  const std::string payload(size, 'I');
+  std::atomic<uint64_t> sent{0};
+  const uint64_t before{framesReceived};
+  const uint64_t start{bench::nowNanos()};
+  const uint64_t deadline{start + durationMs * 1000000ull};
+
+  std::vector<std::thread> senders;
+  for (auto &client : clients) {
+    senders.emplace_back([&client, &payload, &sent, deadline] {
+      while (bench::nowNanos() < deadline) {
+        if (!client.sendFrame(kTextFrame, payload.data(), payload.size()))
+          break;
+        ++sent;
+      }
+    });
+  }
+  for (auto &sender : senders) sender.join();
+
+  // Frames still queued in socket buffers count, the time to drain them too
+  if (!waitFor([&] { return framesReceived - before >= sent; }, 30000))
+    fprintf(stderr, "inbound: server did not drain all frames\n");
+  const double seconds{(bench::nowNanos() - start) / 1e9};
+  return (framesReceived - before) / seconds;
+}
+
+void runEcho(std::vector<Client> &clients, size_t size, uint32_t durationMs,
+  bench::LatencyRecorder &rtt) {
+  std::string payload(size, 'e');
+  payload[0] = 'E';
+  const uint64_t deadline{bench::nowNanos() + durationMs * 1000000ull};
+
+  std::vector<bench::LatencyRecorder> results(clients.size());
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < clients.size(); i++) {
+    workers.emplace_back([&, i] {
+      std::string reply;
+      uint8_t opcode;
+      while (bench::nowNanos() < deadline) {
+        const uint64_t start{bench::nowNanos()};
+        if (!clients[i].sendFrame(kTextFrame, payload.data(), payload.size()) ||
+            !clients[i].readFrame(opcode, reply))
+          break;
+        results[i].add(bench::nowNanos() - start);
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  for (const auto &result : results) rtt.merge(result);
+}
+
+void runBroadcast(std::vector<Client> &clients, size_t size, uint32_t rounds,
+  bench::LatencyRecorder &delivery, bench::LatencyRecorder &fanout) {
+  std::atomic<uint32_t> delivered{0};
+  std::atomic<bool> done{false};
+
+  std::vector<bench::LatencyRecorder> results(clients.size());
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < clients.size(); i++) {
+    readers.emplace_back([&, i] {
+      bench::setSocketTimeout(clients[i].fd(), 100);
+      std::string payload;
+      uint8_t opcode;
+      while (!done) {
+        if (!clients[i].readFrame(opcode, payload)) continue;
+        const uint64_t now{bench::nowNanos()};
+        if (payload.size() < kBroadcastHeader || payload[0] != 'B') continue;
+        const uint64_t sentAt{
+          strtoull(payload.substr(1, kBroadcastHeader - 1).c_str(), nullptr, 16)};
+        results[i].add(now - sentAt);
+        ++delivered;
+      }
+      bench::setSocketTimeout(clients[i].fd(), 5000);
+    });
+  }
+
+  for (uint32_t round = 0; round < rounds; round++) {
+    const uint32_t expected{
+      static_cast<uint32_t>((round + 1) * clients.size())};
+    const uint64_t start{bench::nowNanos()};
+    broadcastRequest = size;
+    if (!waitFor([&] { return delivered >= expected; }, 1000)) break;
+    fanout.add(bench::nowNanos() - start);
+  }
+
+  done = true;
+  for (auto &reader : readers) reader.join();
+  for (const auto &result : results) delivery.merge(result);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<uint32_t> clientCounts{1, 2, 4, 8};
+  std::vector<uint32_t> sizes{32, 64, 128, 250};
+  uint32_t durationMs{1000};
+  uint32_t rounds{200};
+  uint16_t port{18090};
+  const char *label{""};
+  std::vector<std::string> phases{"inbound", "echo", "broadcast"};
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : "";
+    if (!strcmp(arg, "--clients")) {
+      clientCounts = bench::parseNumberList(value), ++i;
+    } else if (!strcmp(arg, "--sizes")) {
+      sizes = bench::parseNumberList(value), ++i;
+    } else if (!strcmp(arg, "--duration")) {
+      durationMs = atoi(value), ++i;
+    } else if (!strcmp(arg, "--broadcasts")) {
+      rounds = atoi(value), ++i;
+    } else if (!strcmp(arg, "--phases")) {
+      phases = bench::parseNameList(value), ++i;
+    } else if (!strcmp(arg, "--port")) {
+      port = atoi(value), ++i;
+    } else if (!strcmp(arg, "--label")) {
+      label = value, ++i;
+    } else {
+      fprintf(stderr, "unknown option: %s\n", arg);
+      return 2;
+    }
+  }
+
+  setenv("HOST_SERIAL", "0", 0);
+
+  webSocket = new DIYables_ESP32_WebSocket(port);
+  webSocket->onOpen(onOpen);
+  webSocket->onMessage(onMessage);
+  webSocket->onClose(onClose);
+  if (!webSocket->begin()) {
+    fprintf(stderr, "cannot start the WebSocket server on port %u\n", port);
+    return 1;
+  }
+  std::thread serverThread{runServer};
+
+  fprintf(stderr, "%7s %5s %12s %10s %10s %12s %12s %12s\n", "clients",
+    "size", "inbound f/s", "echo p50", "echo p99", "bcast p50", "bcast p99",
+    "fanout p99");
+
+  for (const auto count : clientCounts) {
+    for (const auto size : sizes) {
+      if (count == 0 || size == 0) continue;
+
+      std::vector<Client> clients(count);
+      bool connected{true};
+      for (auto &client : clients) connected = connected && client.connect(port);
+      if (!connected ||
+          !waitFor([&] { return openClients == static_cast<int>(count); },
+            2000)) {
+        fprintf(stderr, "could not open %u connections\n", count);
+        continue;
+      }
+
+      double inbound{0};
+      if (bench::contains(phases, "inbound"))
+        inbound = runInbound(clients, size, durationMs);
+      bench::LatencyRecorder rtt;
+      if (bench::contains(phases, "echo"))
+        runEcho(clients, size, durationMs, rtt);
+      bench::LatencyRecorder delivery, fanout;
+      if (bench::contains(phases, "broadcast"))
+        runBroadcast(clients, std::max<size_t>(size, kBroadcastHeader), rounds,
+          delivery, fanout);
+
+      clients.clear(); // sends close frames
+      waitFor([] { return openClients == 0; }, 2000);
+
+      bench::JsonLine line;
+      line.add("suite", "websocket")
+        .add("label", label)
+        .add("clients", count)
+        .add("payload", size)
+        .add("inbound_fps", inbound)
+        .add("echo_count", static_cast<uint64_t>(rtt.count()))
+        .add("echo_rps", rtt.count() / (durationMs / 1000.0))
+        .addLatency("echo_rtt", rtt)
+        .add("broadcasts", static_cast<uint64_t>(fanout.count()))
+        .addLatency("broadcast_delivery", delivery)
+        .addLatency("broadcast_fanout", fanout);
+      line.print(stdout);
+
+      fprintf(stderr, "%7u %5u %12.0f %10.1f %10.1f %12.1f %12.1f %12.1f\n",
+        count, size, inbound, rtt.percentileMicros(50), rtt.percentileMicros(99),
+        delivery.percentileMicros(50), delivery.percentileMicros(99),
+        fanout.percentileMicros(99));
+    }
+  }
+
+  serverRunning = false;
+  serverThread.join();
+  return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ * Arduino.h
+ *
+ * Host build stand-in for the ESP32 Arduino core.
+ * Provides the subset of the core used by the library and its examples:
+ * timing, random numbers, GPIO no-ops, Serial, String and PROGMEM helpers.
+ */
+
+#pragma once
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <algorithm>
+
+#include "IPAddress.h"
+#include "Print.h"
+#include "WString.h"
+#include "pgmspace.h"
+
+using std::max;
+using std::min;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+/**
+ * @brief newlib flavoured strtok_r().
+ * The ESP32 toolchain (newlib) sets *saveptr to NULL once the last token has
+ * been returned, glibc leaves it pointing at the terminator. The WebSocket
+ * handshake parser loops on that NULL, so the host build uses newlib's rule.
+ */
+char *host_strtok_r(char *str, const char *delim, char **saveptr);
+#define strtok_r host_strtok_r
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+
+/**
+ * @brief Serial port stand-in, writes to stdout.
+ * @remark Output can be silenced with the HOST_SERIAL=0 environment variable,
+ * which keeps log formatting out of profiles and benchmarks.
+ */
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  void end() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  void flush() override;
+  operator bool() const { return true; }
+
+private:
+  int m_enabled{-1};
+  bool _enabled();
+};
+
+extern HardwareSerial Serial;
+
+/** @brief Subset of the ESP32 EspClass (chip/heap information). */
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  void restart();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,33 @@
+/*
+ * IPAddress.h
+ *
+ * Host build stand-in for the Arduino IPAddress class (IPv4 only).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "Print.h"
+
+class IPAddress : public Printable {
+public:
+  IPAddress() : m_address{0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d);
+  /** @param address IPv4 address in network byte order. */
+  IPAddress(uint32_t address) : m_address{address} {}
+
+  /** @return Address in network byte order. */
+  operator uint32_t() const { return m_address; }
+  uint8_t operator[](int index) const;
+  bool operator==(const IPAddress &rhs) const {
+    return m_address == rhs.m_address;
+  }
+  bool operator!=(const IPAddress &rhs) const { return !(*this == rhs); }
+
+  String toString() const;
+  size_t printTo(Print &p) const override;
+
+private:
+  uint32_t m_address;
+};
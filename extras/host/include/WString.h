@@ -0,0 +1,117 @@
+/*
+ * WString.h
+ *
+ * Host build stand-in for the Arduino String class.
+ * Backed by std::string; only the members used by the library and the
+ * bundled examples are provided.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class __FlashStringHelper;
+#define F(string_literal)                                                      \
+  (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String {
+public:
+  String(const char *cstr = "");
+  String(const char *cstr, unsigned int length);
+  String(const __FlashStringHelper *str);
+  String(const std::string &str) : m_str(str) {}
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+
+  bool reserve(unsigned int size);
+  unsigned int length() const { return static_cast<unsigned int>(m_str.size()); }
+  bool isEmpty() const { return m_str.empty(); }
+  const char *c_str() const { return m_str.c_str(); }
+  char *begin() { return &m_str[0]; }
+  char *end() { return begin() + m_str.size(); }
+
+  bool concat(const String &str);
+  bool concat(const char *cstr);
+  bool concat(const char *cstr, unsigned int length);
+  bool concat(char c);
+  bool concat(unsigned char value);
+  bool concat(int value);
+  bool concat(unsigned int value);
+  bool concat(long value);
+  bool concat(unsigned long value);
+  bool concat(long long value);
+  bool concat(unsigned long long value);
+  bool concat(float value);
+  bool concat(double value);
+  bool concat(const __FlashStringHelper *str);
+
+  template <typename T> String &operator+=(const T &rhs) {
+    concat(rhs);
+    return *this;
+  }
+
+  int compareTo(const String &s) const;
+  bool equals(const String &s) const { return m_str == s.m_str; }
+  bool equals(const char *cstr) const;
+  bool equalsIgnoreCase(const String &s) const;
+  bool equalsConstantTime(const String &s) const;
+  bool startsWith(const String &prefix) const;
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool endsWith(const String &suffix) const;
+
+  bool operator==(const String &rhs) const { return equals(rhs); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &rhs) const { return !equals(rhs); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+  bool operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+
+  char charAt(unsigned int index) const;
+  void setCharAt(unsigned int index, char c);
+  char operator[](unsigned int index) const { return charAt(index); }
+  char &operator[](unsigned int index);
+  void getBytes(unsigned char *buf, unsigned int bufsize,
+    unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int bufsize,
+    unsigned int index = 0) const {
+    getBytes(reinterpret_cast<unsigned char *>(buf), bufsize, index);
+  }
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const;
+  int indexOf(const String &str, unsigned int fromIndex = 0) const;
+  int indexOf(const char *str, unsigned int fromIndex = 0) const;
+  int lastIndexOf(char ch) const;
+  int lastIndexOf(const String &str) const;
+  String substring(unsigned int beginIndex) const;
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+private:
+  std::string m_str;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
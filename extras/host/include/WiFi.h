@@ -0,0 +1,43 @@
+/*
+ * WiFi.h
+ *
+ * Host build stand-in for the ESP32 WiFi library.
+ * The "station" is always connected; localIP() reports the loopback address
+ * unless HOST_IP is set in the environment.
+ */
+
+#pragma once
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+
+typedef enum {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+class WiFiClass {
+public:
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr);
+  bool disconnect(bool wifiOff = false, bool eraseAp = false);
+  wl_status_t status();
+  bool isConnected() { return status() == WL_CONNECTED; }
+
+  IPAddress localIP();
+  String SSID();
+  int8_t RSSI();
+  String macAddress();
+
+private:
+  String m_ssid{"host"};
+  bool m_connected{true};
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,61 @@
+/*
+ * WiFiClient.h
+ *
+ * Host build stand-in for the ESP32 WiFiClient, backed by a POSIX TCP socket.
+ *
+ * Mirrors the ESP32 semantics the library relies on:
+ * - copies share one underlying socket (like the ESP32 shared_ptr handle),
+ * - reads are non-blocking and served from a small receive buffer,
+ * - writes block (with a timeout) until all bytes are handed to the kernel,
+ * - flush() discards pending input, stop() closes the socket for all copies.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "Arduino.h"
+
+class WiFiClientSocket;
+
+class WiFiClient : public Print {
+public:
+  WiFiClient();
+  /** @brief Takes ownership of an already-connected socket. */
+  explicit WiFiClient(int fd);
+  ~WiFiClient() override;
+
+  int connect(IPAddress ip, uint16_t port);
+  int connect(const char *host, uint16_t port);
+
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+  int available();
+  int read();
+  int read(uint8_t *buffer, size_t size);
+  int read(char *buffer, size_t size) {
+    return read(reinterpret_cast<uint8_t *>(buffer), size);
+  }
+  int peek();
+  void flush() override;
+  void stop();
+  uint8_t connected();
+  void setNoDelay(bool nodelay);
+  void setTimeout(uint32_t seconds);
+
+  int fd() const;
+  IPAddress remoteIP() const;
+  uint16_t remotePort() const;
+  IPAddress localIP() const;
+  uint16_t localPort() const;
+
+  operator bool() { return connected(); }
+  bool operator==(const WiFiClient &rhs) const;
+  bool operator!=(const WiFiClient &rhs) const { return !(*this == rhs); }
+
+private:
+  std::shared_ptr<WiFiClientSocket> m_socket;
+  uint32_t m_timeout{3000};
+};
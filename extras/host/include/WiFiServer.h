@@ -0,0 +1,40 @@
+/*
+ * WiFiServer.h
+ *
+ * Host build stand-in for the ESP32 WiFiServer, backed by a non-blocking
+ * POSIX listening socket bound to all interfaces.
+ */
+
+#pragma once
+
+#include "WiFiClient.h"
+
+class WiFiServer {
+public:
+  WiFiServer(uint16_t port = 80, uint8_t maxClients = 4);
+  WiFiServer(const WiFiServer &) = delete;
+  ~WiFiServer();
+
+  WiFiServer &operator=(const WiFiServer &) = delete;
+
+  void begin(uint16_t port = 0);
+  void end();
+  void close() { end(); }
+  void stop() { end(); }
+
+  /** @return Accepted client or an invalid one (never blocks). */
+  WiFiClient accept();
+  WiFiClient available() { return accept(); }
+  bool hasClient();
+  void setNoDelay(bool nodelay) { m_noDelay = nodelay; }
+
+  int fd() const { return m_fd; }
+  uint16_t port() const { return m_port; }
+  operator bool() const { return m_fd >= 0; }
+
+private:
+  int m_fd{-1};
+  uint16_t m_port;
+  uint8_t m_maxClients;
+  bool m_noDelay{false};
+};
@@ -0,0 +1,134 @@
+/*
+ * Arduino.cpp
+ *
+ * Host build implementation of the Arduino core stand-ins.
+ */
+
+#include "Arduino.h"
+
+#include <malloc.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <x86intrin.h>
+#endif
+
+HardwareSerial Serial;
+EspClass ESP;
+
+namespace {
+
+uint64_t monotonicMicros() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+const uint64_t kStartMicros{monotonicMicros()};
+
+} // namespace
+
+uint32_t millis() {
+  return static_cast<uint32_t>((monotonicMicros() - kStartMicros) / 1000);
+}
+uint32_t micros() {
+  return static_cast<uint32_t>(monotonicMicros() - kStartMicros);
+}
+void delay(uint32_t ms) {
+  if (ms == 0) return;
+  usleep(ms * 1000);
+}
+void delayMicroseconds(uint32_t us) { usleep(us); }
+void yield() {}
+
+long random(long howbig) {
+  if (howbig <= 0) return 0;
+  return ::random() % howbig;
+}
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+void randomSeed(unsigned long seed) {
+  if (seed != 0) srandom(static_cast<unsigned>(seed));
+}
+
+char *host_strtok_r(char *str, const char *delim, char **saveptr) {
+  char *s = str ? str : *saveptr;
+  if (!s) return nullptr;
+
+  s += strspn(s, delim);
+  if (*s == '\0') {
+    *saveptr = nullptr;
+    return nullptr;
+  }
+
+  char *token = s;
+  s = strpbrk(token, delim);
+  if (s) {
+    *s = '\0';
+    *saveptr = s + 1;
+  } else {
+    *saveptr = nullptr;
+  }
+  return token;
+}
+
+void pinMode(uint8_t, uint8_t) {}
+void digitalWrite(uint8_t, uint8_t) {}
+int digitalRead(uint8_t) { return LOW; }
+uint16_t analogRead(uint8_t) {
+  return static_cast<uint16_t>(monotonicMicros() & 0x0FFF);
+}
+
+//
+// HardwareSerial:
+//
+
+void HardwareSerial::begin(unsigned long) {}
+
+bool HardwareSerial::_enabled() {
+  if (m_enabled < 0) {
+    const char *env = getenv("HOST_SERIAL");
+    m_enabled = !(env && strcmp(env, "0") == 0);
+  }
+  return m_enabled;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!_enabled()) return 1;
+  return fwrite(&c, 1, 1, stdout);
+}
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (!_enabled()) return size;
+  return fwrite(buffer, 1, size, stdout);
+}
+void HardwareSerial::flush() { fflush(stdout); }
+
+//
+// EspClass:
+//
+
+uint32_t EspClass::getCycleCount() {
+#if defined(__x86_64__) || defined(__i386__)
+  return static_cast<uint32_t>(__rdtsc());
+#else
+  return static_cast<uint32_t>(monotonicMicros() * 1000);
+#endif
+}
+uint32_t EspClass::getHeapSize() {
+  const auto info = mallinfo2();
+  return static_cast<uint32_t>(info.arena + info.hblkhd);
+}
+uint32_t EspClass::getFreeHeap() {
+  const auto info = mallinfo2();
+  return static_cast<uint32_t>(info.fordblks);
+}
+uint32_t EspClass::getMinFreeHeap() { return getFreeHeap(); }
+uint32_t EspClass::getMaxAllocHeap() {
+  const auto info = mallinfo2();
+  return static_cast<uint32_t>(info.fordblks > info.keepcost ? info.fordblks
+                                                               : info.keepcost);
+}
+void EspClass::restart() { exit(0); }
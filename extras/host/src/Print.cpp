@@ -0,0 +1,136 @@
+/*
+ * Print.cpp
+ *
+ * Host build implementation of the Arduino Print and IPAddress stand-ins.
+ */
+
+#include "IPAddress.h"
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) break;
+    ++n;
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  const int length = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (length < 0) return 0;
+  if (static_cast<size_t>(length) < sizeof(buffer))
+    return write(buffer, length);
+
+  std::string large(length + 1, '\0');
+  va_start(args, format);
+  vsnprintf(&large[0], large.size(), format, args);
+  va_end(args);
+  return write(large.data(), length);
+}
+
+size_t Print::printNumber(unsigned long long n, uint8_t base) {
+  if (base < 2) base = 10;
+  char buffer[8 * sizeof(n) + 1];
+  char *p = &buffer[sizeof(buffer) - 1];
+  *p = '\0';
+  do {
+    const char digit = static_cast<char>(n % base);
+    *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+    n /= base;
+  } while (n);
+  return write(p);
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return write(reinterpret_cast<const char *>(str));
+}
+size_t Print::print(const String &s) { return write(s.c_str(), s.length()); }
+size_t Print::print(const char str[]) { return write(str); }
+size_t Print::print(char c) { return write(static_cast<uint8_t>(c)); }
+size_t Print::print(unsigned char n, int base) {
+  return print(static_cast<unsigned long long>(n), base);
+}
+size_t Print::print(int n, int base) {
+  return print(static_cast<long long>(n), base);
+}
+size_t Print::print(unsigned int n, int base) {
+  return print(static_cast<unsigned long long>(n), base);
+}
+size_t Print::print(long n, int base) {
+  return print(static_cast<long long>(n), base);
+}
+size_t Print::print(unsigned long n, int base) {
+  return print(static_cast<unsigned long long>(n), base);
+}
+size_t Print::print(long long n, int base) {
+  if (base == 0) return write(static_cast<uint8_t>(n));
+  if (base == 10 && n < 0) {
+    const size_t t = print('-');
+    return t + printNumber(0ULL - static_cast<unsigned long long>(n), 10);
+  }
+  return printNumber(static_cast<unsigned long long>(n), base);
+}
+size_t Print::print(unsigned long long n, int base) {
+  if (base == 0) return write(static_cast<uint8_t>(n));
+  return printNumber(n, base);
+}
+size_t Print::print(double n, int digits) {
+  char buffer[64];
+  const int length = snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return write(buffer, length > 0 ? length : 0);
+}
+size_t Print::print(const Printable &x) { return x.printTo(*this); }
+
+size_t Print::println() { return write("\r\n"); }
+
+#define PRINTLN_IMPL(...)                                                      \
+  {                                                                            \
+    const size_t n = print(__VA_ARGS__);                                       \
+    return n + println();                                                      \
+  }
+
+size_t Print::println(const __FlashStringHelper *s) PRINTLN_IMPL(s)
+size_t Print::println(const String &s) PRINTLN_IMPL(s)
+size_t Print::println(const char c[]) PRINTLN_IMPL(c)
+size_t Print::println(char c) PRINTLN_IMPL(c)
+size_t Print::println(unsigned char b, int base) PRINTLN_IMPL(b, base)
+size_t Print::println(int num, int base) PRINTLN_IMPL(num, base)
+size_t Print::println(unsigned int num, int base) PRINTLN_IMPL(num, base)
+size_t Print::println(long num, int base) PRINTLN_IMPL(num, base)
+size_t Print::println(unsigned long num, int base) PRINTLN_IMPL(num, base)
+size_t Print::println(long long num, int base) PRINTLN_IMPL(num, base)
+size_t Print::println(unsigned long long num, int base) PRINTLN_IMPL(num, base)
+size_t Print::println(double num, int digits) PRINTLN_IMPL(num, digits)
+size_t Print::println(const Printable &x) PRINTLN_IMPL(x)
+
+#undef PRINTLN_IMPL
+
+//
+// IPAddress:
+//
+
+IPAddress::IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+  : m_address{static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+              (static_cast<uint32_t>(c) << 16) |
+              (static_cast<uint32_t>(d) << 24)} {}
+
+uint8_t IPAddress::operator[](int index) const {
+  return static_cast<uint8_t>((m_address >> (8 * (index & 3))) & 0xFF);
+}
+
+String IPAddress::toString() const {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1],
+    (*this)[2], (*this)[3]);
+  return String(buffer);
+}
+
+size_t IPAddress::printTo(Print &p) const { return p.print(toString()); }
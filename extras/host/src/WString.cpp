@@ -0,0 +1,253 @@
+/*
+ * WString.cpp
+ *
+ * Host build implementation of the Arduino String stand-in.
+ */
+
+#include "WString.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+namespace {
+
+std::string toBase(
+  unsigned long long value, unsigned char base, bool negative = false) {
+  if (base < 2 || base > 36) base = 10;
+  char buffer[8 * sizeof(value) + 2];
+  char *p = &buffer[sizeof(buffer) - 1];
+  *p = '\0';
+  do {
+    const auto digit = static_cast<char>(value % base);
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  // The sign goes into the same buffer: no concatenation, no second copy
+  if (negative) *--p = '-';
+  return p;
+}
+
+std::string toSigned(long long value, unsigned char base) {
+  if (base == 10 && value < 0)
+    return toBase(0ULL - static_cast<unsigned long long>(value), base, true);
+  return toBase(static_cast<unsigned long long>(value), base);
+}
+
+std::string toFixed(double value, unsigned int decimalPlaces) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, value);
+  return buffer;
+}
+
+} // namespace
+
+String::String(const char *cstr) : m_str(cstr ? cstr : "") {}
+String::String(const char *cstr, unsigned int length)
+  : m_str(cstr ? std::string(cstr, length) : std::string()) {}
+String::String(const __FlashStringHelper *str)
+  : String(reinterpret_cast<const char *>(str)) {}
+String::String(char c) : m_str(1, c) {}
+String::String(unsigned char value, unsigned char base)
+  : m_str(toBase(value, base)) {}
+String::String(int value, unsigned char base) : m_str(toSigned(value, base)) {}
+String::String(unsigned int value, unsigned char base)
+  : m_str(toBase(value, base)) {}
+String::String(long value, unsigned char base)
+  : m_str(toSigned(value, base)) {}
+String::String(unsigned long value, unsigned char base)
+  : m_str(toBase(value, base)) {}
+String::String(long long value, unsigned char base)
+  : m_str(toSigned(value, base)) {}
+String::String(unsigned long long value, unsigned char base)
+  : m_str(toBase(value, base)) {}
+String::String(float value, unsigned int decimalPlaces)
+  : m_str(toFixed(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces)
+  : m_str(toFixed(value, decimalPlaces)) {}
+
+bool String::reserve(unsigned int size) {
+  m_str.reserve(size);
+  return true;
+}
+
+bool String::concat(const String &str) {
+  m_str += str.m_str;
+  return true;
+}
+bool String::concat(const char *cstr) {
+  if (!cstr) return false;
+  m_str += cstr;
+  return true;
+}
+bool String::concat(const char *cstr, unsigned int length) {
+  if (!cstr) return false;
+  m_str.append(cstr, length);
+  return true;
+}
+bool String::concat(char c) {
+  m_str += c;
+  return true;
+}
+bool String::concat(unsigned char value) { return concat(String(value)); }
+bool String::concat(int value) { return concat(String(value)); }
+bool String::concat(unsigned int value) { return concat(String(value)); }
+bool String::concat(long value) { return concat(String(value)); }
+bool String::concat(unsigned long value) { return concat(String(value)); }
+bool String::concat(long long value) { return concat(String(value)); }
+bool String::concat(unsigned long long value) {
+  return concat(String(value));
+}
+bool String::concat(float value) { return concat(String(value)); }
+bool String::concat(double value) { return concat(String(value)); }
+bool String::concat(const __FlashStringHelper *str) {
+  return concat(reinterpret_cast<const char *>(str));
+}
+
+int String::compareTo(const String &s) const { return m_str.compare(s.m_str); }
+bool String::equals(const char *cstr) const {
+  return m_str == (cstr ? cstr : "");
+}
+bool String::equalsIgnoreCase(const String &s) const {
+  return m_str.size() == s.m_str.size() &&
+         strcasecmp(m_str.c_str(), s.m_str.c_str()) == 0;
+}
+bool String::equalsConstantTime(const String &s) const {
+  if (m_str.size() != s.m_str.size()) return false;
+  unsigned char diff = 0;
+  for (size_t i = 0; i < m_str.size(); ++i)
+    diff |= static_cast<unsigned char>(m_str[i] ^ s.m_str[i]);
+  return diff == 0;
+}
+bool String::startsWith(const String &prefix) const {
+  return m_str.compare(0, prefix.m_str.size(), prefix.m_str) == 0;
+}
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  if (offset > m_str.size()) return false;
+  return m_str.compare(offset, prefix.m_str.size(), prefix.m_str) == 0;
+}
+bool String::endsWith(const String &suffix) const {
+  if (suffix.m_str.size() > m_str.size()) return false;
+  return m_str.compare(m_str.size() - suffix.m_str.size(), suffix.m_str.size(),
+           suffix.m_str) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return index < m_str.size() ? m_str[index] : '\0';
+}
+void String::setCharAt(unsigned int index, char c) {
+  if (index < m_str.size()) m_str[index] = c;
+}
+char &String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= m_str.size()) {
+    dummy = '\0';
+    return dummy;
+  }
+  return m_str[index];
+}
+void String::getBytes(
+  unsigned char *buf, unsigned int bufsize, unsigned int index) const {
+  if (!bufsize || !buf) return;
+  if (index >= m_str.size()) {
+    buf[0] = '\0';
+    return;
+  }
+  size_t n = std::min<size_t>(bufsize - 1, m_str.size() - index);
+  memcpy(buf, m_str.data() + index, n);
+  buf[n] = '\0';
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+  const auto pos = m_str.find(ch, fromIndex);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+int String::indexOf(const String &str, unsigned int fromIndex) const {
+  const auto pos = m_str.find(str.m_str, fromIndex);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+int String::indexOf(const char *str, unsigned int fromIndex) const {
+  const auto pos = m_str.find(str ? str : "", fromIndex);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+int String::lastIndexOf(char ch) const {
+  const auto pos = m_str.rfind(ch);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+int String::lastIndexOf(const String &str) const {
+  const auto pos = m_str.rfind(str.m_str);
+  return pos == std::string::npos ? -1 : static_cast<int>(pos);
+}
+String String::substring(unsigned int beginIndex) const {
+  if (beginIndex >= m_str.size()) return String();
+  return String(m_str.substr(beginIndex));
+}
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+  if (beginIndex >= m_str.size()) return String();
+  if (endIndex > m_str.size()) endIndex = m_str.size();
+  return String(m_str.substr(beginIndex, endIndex - beginIndex));
+}
+
+void String::replace(char find, char replace) {
+  for (auto &c : m_str)
+    if (c == find) c = replace;
+}
+void String::replace(const String &find, const String &replace) {
+  if (find.m_str.empty()) return;
+  size_t pos = 0;
+  while ((pos = m_str.find(find.m_str, pos)) != std::string::npos) {
+    m_str.replace(pos, find.m_str.size(), replace.m_str);
+    pos += replace.m_str.size();
+  }
+}
+void String::remove(unsigned int index) {
+  if (index < m_str.size()) m_str.erase(index);
+}
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < m_str.size()) m_str.erase(index, count);
+}
+void String::toLowerCase() {
+  for (auto &c : m_str)
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+}
+void String::toUpperCase() {
+  for (auto &c : m_str)
+    c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+}
+void String::trim() {
+  const auto first = m_str.find_first_not_of(" \t\r\n\f\v");
+  if (first == std::string::npos) {
+    m_str.clear();
+    return;
+  }
+  const auto last = m_str.find_last_not_of(" \t\r\n\f\v");
+  m_str = m_str.substr(first, last - first + 1);
+}
+
+long String::toInt() const { return atol(m_str.c_str()); }
+float String::toFloat() const { return static_cast<float>(toDouble()); }
+double String::toDouble() const { return atof(m_str.c_str()); }
+
+String operator+(const String &lhs, const String &rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+String operator+(const String &lhs, const char *rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+String operator+(const char *lhs, const String &rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
+String operator+(const String &lhs, char rhs) {
+  String result(lhs);
+  result.concat(rhs);
+  return result;
+}
@@ -0,0 +1,318 @@
+/*
+ * WiFiClient.cpp
+ *
+ * Host build implementation of WiFiClient/WiFiServer/WiFi over POSIX sockets.
+ */
+
+#include "WiFi.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClass WiFi;
+
+namespace {
+
+/** Same size as the ESP32 core receive buffer (one TCP MSS). */
+constexpr size_t kRxBufferSize{1436};
+
+void setNonBlocking(int fd) {
+  const int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+} // namespace
+
+class WiFiClientSocket {
+public:
+  explicit WiFiClientSocket(int fd) : m_fd{fd} { setNonBlocking(fd); }
+  ~WiFiClientSocket() { close(); }
+
+  void close() {
+    if (m_fd >= 0) {
+      ::close(m_fd);
+      m_fd = -1;
+    }
+    m_head = m_tail = 0;
+  }
+
+  int fd() const { return m_fd; }
+
+  /** @return Buffered + kernel-pending byte count. */
+  size_t available() {
+    if (m_fd < 0) return 0;
+    int pending = 0;
+    if (ioctl(m_fd, FIONREAD, &pending) < 0) pending = 0;
+    return (m_tail - m_head) + pending;
+  }
+
+  /** @return false when the peer closed the connection or on error. */
+  bool fill() {
+    if (m_head < m_tail) return true;
+    if (m_fd < 0) return false;
+    m_head = m_tail = 0;
+    const ssize_t n = recv(m_fd, m_buffer, kRxBufferSize, MSG_DONTWAIT);
+    if (n > 0) {
+      m_tail = n;
+      return true;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) m_eof = true;
+    return false;
+  }
+
+  int read(uint8_t *buffer, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+      if (m_head == m_tail && !fill()) break;
+      const size_t n = std::min(size - total, m_tail - m_head);
+      memcpy(buffer + total, m_buffer + m_head, n);
+      m_head += n;
+      total += n;
+    }
+    return total ? static_cast<int>(total) : -1;
+  }
+  int peek() {
+    if (m_head == m_tail && !fill()) return -1;
+    return m_buffer[m_head];
+  }
+  void discard() {
+    m_head = m_tail = 0;
+    uint8_t scratch[256];
+    while (m_fd >= 0 && recv(m_fd, scratch, sizeof(scratch), MSG_DONTWAIT) > 0)
+      ;
+  }
+
+  bool connected() {
+    if (m_fd < 0) return false;
+    if (m_head < m_tail) return true;
+    uint8_t dummy;
+    const ssize_t n = recv(m_fd, &dummy, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n > 0) return true;
+    if (n == 0) return false;
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+
+  size_t write(const uint8_t *buffer, size_t size, uint32_t timeoutMs) {
+    size_t total = 0;
+    while (m_fd >= 0 && total < size) {
+      const ssize_t n =
+        send(m_fd, buffer + total, size - total, MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (n > 0) {
+        total += n;
+        continue;
+      }
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        pollfd pfd{m_fd, POLLOUT, 0};
+        if (poll(&pfd, 1, timeoutMs) <= 0) break;
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      break;
+    }
+    return total;
+  }
+
+private:
+  int m_fd;
+  bool m_eof{false};
+  uint8_t m_buffer[kRxBufferSize];
+  size_t m_head{0};
+  size_t m_tail{0};
+};
+
+//
+// WiFiClient:
+//
+
+WiFiClient::WiFiClient() = default;
+WiFiClient::WiFiClient(int fd)
+  : m_socket{fd >= 0 ? std::make_shared<WiFiClientSocket>(fd) : nullptr} {}
+WiFiClient::~WiFiClient() = default;
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+  stop();
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return 0;
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = static_cast<uint32_t>(ip);
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    ::close(fd);
+    return 0;
+  }
+  m_socket = std::make_shared<WiFiClientSocket>(fd);
+  return 1;
+}
+int WiFiClient::connect(const char *host, uint16_t port) {
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *result{nullptr};
+  if (getaddrinfo(host, nullptr, &hints, &result) != 0 || !result) return 0;
+  const auto ip =
+    reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr.s_addr;
+  freeaddrinfo(result);
+  return connect(IPAddress(static_cast<uint32_t>(ip)), port);
+}
+
+size_t WiFiClient::write(uint8_t data) { return write(&data, 1); }
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+  if (!m_socket || !buffer || !size) return 0;
+  return m_socket->write(buffer, size, m_timeout);
+}
+
+int WiFiClient::available() {
+  return m_socket ? static_cast<int>(m_socket->available()) : 0;
+}
+int WiFiClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+int WiFiClient::read(uint8_t *buffer, size_t size) {
+  return m_socket ? m_socket->read(buffer, size) : -1;
+}
+int WiFiClient::peek() { return m_socket ? m_socket->peek() : -1; }
+void WiFiClient::flush() {
+  if (m_socket) m_socket->discard();
+}
+void WiFiClient::stop() {
+  if (m_socket) m_socket->close();
+  m_socket.reset();
+}
+uint8_t WiFiClient::connected() { return m_socket && m_socket->connected(); }
+
+void WiFiClient::setNoDelay(bool nodelay) {
+  if (!m_socket || m_socket->fd() < 0) return;
+  const int flag = nodelay;
+  setsockopt(m_socket->fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+void WiFiClient::setTimeout(uint32_t seconds) { m_timeout = seconds * 1000; }
+
+int WiFiClient::fd() const { return m_socket ? m_socket->fd() : -1; }
+
+IPAddress WiFiClient::remoteIP() const {
+  sockaddr_in addr{};
+  socklen_t length = sizeof(addr);
+  if (fd() < 0 ||
+      getpeername(fd(), reinterpret_cast<sockaddr *>(&addr), &length) < 0)
+    return IPAddress();
+  return IPAddress(static_cast<uint32_t>(addr.sin_addr.s_addr));
+}
+uint16_t WiFiClient::remotePort() const {
+  sockaddr_in addr{};
+  socklen_t length = sizeof(addr);
+  if (fd() < 0 ||
+      getpeername(fd(), reinterpret_cast<sockaddr *>(&addr), &length) < 0)
+    return 0;
+  return ntohs(addr.sin_port);
+}
+IPAddress WiFiClient::localIP() const {
+  sockaddr_in addr{};
+  socklen_t length = sizeof(addr);
+  if (fd() < 0 ||
+      getsockname(fd(), reinterpret_cast<sockaddr *>(&addr), &length) < 0)
+    return IPAddress();
+  return IPAddress(static_cast<uint32_t>(addr.sin_addr.s_addr));
+}
+uint16_t WiFiClient::localPort() const {
+  sockaddr_in addr{};
+  socklen_t length = sizeof(addr);
+  if (fd() < 0 ||
+      getsockname(fd(), reinterpret_cast<sockaddr *>(&addr), &length) < 0)
+    return 0;
+  return ntohs(addr.sin_port);
+}
+
+bool WiFiClient::operator==(const WiFiClient &rhs) const {
+  return m_socket && rhs.m_socket && m_socket == rhs.m_socket;
+}
+
+//
+// WiFiServer:
+//
+
+WiFiServer::WiFiServer(uint16_t port, uint8_t maxClients)
+  : m_port{port}, m_maxClients{maxClients} {}
+WiFiServer::~WiFiServer() { end(); }
+
+void WiFiServer::begin(uint16_t port) {
+  if (port) m_port = port;
+  end();
+
+  m_fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (m_fd < 0) return;
+
+  const int enable = 1;
+  setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(m_port);
+  addr.sin_addr.s_addr = INADDR_ANY;
+  if (bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      listen(m_fd, 128) < 0) {
+    fprintf(stderr, "[host] cannot listen on port %u: %s\n", m_port,
+      strerror(errno));
+    end();
+    return;
+  }
+  setNonBlocking(m_fd);
+}
+void WiFiServer::end() {
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+}
+
+WiFiClient WiFiServer::accept() {
+  if (m_fd < 0) return WiFiClient();
+  const int fd = ::accept(m_fd, nullptr, nullptr);
+  if (fd < 0) return WiFiClient();
+
+  WiFiClient client(fd);
+  if (m_noDelay) client.setNoDelay(true);
+  return client;
+}
+bool WiFiServer::hasClient() {
+  if (m_fd < 0) return false;
+  pollfd pfd{m_fd, POLLIN, 0};
+  return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+}
+
+//
+// WiFiClass:
+//
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *) {
+  if (ssid) m_ssid = ssid;
+  m_connected = true;
+  return WL_CONNECTED;
+}
+bool WiFiClass::disconnect(bool, bool) {
+  // The host "station" reconnects instantly on the next begin().
+  return true;
+}
+wl_status_t WiFiClass::status() {
+  return m_connected ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+IPAddress WiFiClass::localIP() {
+  const char *env = getenv("HOST_IP");
+  in_addr addr{};
+  if (env && inet_aton(env, &addr)) return IPAddress(addr.s_addr);
+  return IPAddress(127, 0, 0, 1);
+}
+String WiFiClass::SSID() { return m_ssid; }
+int8_t WiFiClass::RSSI() { return 0; }
+String WiFiClass::macAddress() { return String("00:00:00:00:00:00"); }
@@ -0,0 +1,19 @@
+/*
+ * main.cpp
+ *
+ * Host build entry point: runs an Arduino sketch's setup() once and then
+ * loop() forever, like the ESP32 core's loopTask.
+ */
+
+#include "Arduino.h"
+
+void setup();
+void loop();
+
+int main() {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  setup();
+  for (;;) {
+    loop();
+  }
+}
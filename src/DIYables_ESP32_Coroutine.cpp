@@ -0,0 +1,213 @@
+#include "DIYables_ESP32_WebServer.h"
+
+#if WEBSERVER_COROUTINES
+
+#include <sys/select.h>
+
+CoroutineScheduler::Slot* CoroutineScheduler::current = nullptr;
+
+// True if a write to the socket would not block
+static bool socketWritable(int fd) {
+  if (fd < 0) return true;  // closed: let the handler find out
+  if (fd >= FD_SETSIZE) return true;  // select() cannot check it: let the write block instead
+  fd_set writeSet;
+  FD_ZERO(&writeSet);
+  FD_SET(fd, &writeSet);
+  struct timeval timeout = {0, 0};
+  return select(fd + 1, nullptr, &writeSet, nullptr, &timeout) > 0;
+}
+
+// BodyAwaiter
+
+bool BodyAwaiter::await_ready() {
+  return request.bodyComplete() || request.client->available() > 0 || !request.client->connected();
+}
+
+void BodyAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  CoroutineScheduler::current->handle = handle;
+  CoroutineScheduler::current->wait = COROUTINE_WAIT_BODY;
+  CoroutineScheduler::current->waitStart = millis();
+}
+
+int BodyAwaiter::await_resume() {
+  size_t remaining = request.contentLength - request.bodyReceived;
+  if (remaining == 0 || request.client->available() <= 0) return 0;
+  int n = request.client->read(buffer, min(size, remaining));
+  if (n <= 0) return 0;
+  request.bodyReceived += n;
+  return n;
+}
+
+// WaitAwaiter
+
+bool WaitAwaiter::await_ready() {
+  if (wait == COROUTINE_WAIT_TIMER) return ms == 0;
+  if (wait == COROUTINE_WAIT_WRITABLE) return socketWritable(CoroutineScheduler::current->client.fd());
+  return false;
+}
+
+void WaitAwaiter::await_suspend(std::coroutine_handle<> handle) {
+  CoroutineScheduler::Slot* slot = CoroutineScheduler::current;
+  slot->handle = handle;
+  slot->wait = wait;
+  slot->waitStart = millis();
+  slot->waitMs = ms;
+}
+
+// Response
+
+void Response::begin(const char* contentType, int statusCode) {
+  server->beginResponse(*client, contentType, statusCode);
+}
+
+size_t Response::write(uint8_t data) {
+  return client->write(data);
+}
+
+size_t Response::write(const uint8_t* data, size_t length) {
+  return client->write(data, length);
+}
+
+bool Response::connected() {
+  return client->connected();
+}
+
+// CoroutineScheduler
+
+CoroutineScheduler::CoroutineScheduler() {
+  for (int i = 0; i < MAX_COROUTINE_HANDLERS; i++) {
+    slots[i].active = false;
+  }
+}
+
+bool CoroutineScheduler::start(CoroutineHandler handler, WiFiClient& client, WebServerBase* server,
+                               const String& method, const String& path, const String& headers,
+                               const QueryParams& params, size_t contentLength) {
+  Slot* slot = nullptr;
+  for (int i = 0; i < MAX_COROUTINE_HANDLERS; i++) {
+    if (!slots[i].active) {
+      slot = &slots[i];
+      break;
+    }
+  }
+  if (slot == nullptr) {
+    server->beginResponse(client, "text/plain", 503);
+    client.print("Too many requests in progress");
+    return false;
+  }
+
+  slot->client = client;
+  slot->request.method = method;
+  slot->request.path = path;
+  slot->request.headers = headers;
+  slot->request.params = params;
+  slot->request.contentLength = contentLength;
+  slot->request.bodyReceived = 0;
+  slot->request.client = &slot->client;
+  slot->response.client = &slot->client;
+  slot->response.server = server;
+
+  // Runs until the handler returns or waits for the first time
+  current = slot;
+  Task task = handler(slot->request, slot->response);
+  current = nullptr;
+
+  slot->handle = task.handle;
+  if (task.handle.done()) {
+    task.handle.destroy();
+    slot->request.headers = String();
+    return false;  // finished: the server closes the connection as usual
+  }
+  slot->active = true;
+  return true;
+}
+
+bool CoroutineScheduler::isReady(Slot& slot) {
+  switch (slot.wait) {
+    case COROUTINE_WAIT_TIMER:
+      return millis() - slot.waitStart >= slot.waitMs;
+    case COROUTINE_WAIT_WRITABLE:
+      return socketWritable(slot.client.fd());
+    case COROUTINE_WAIT_BODY:
+      return slot.request.bodyComplete() || slot.client.available() > 0 || !slot.client.connected();
+    case COROUTINE_WAIT_YIELD:
+    default:
+      return true;
+  }
+}
+
+// Waiting on a client that neither sends nor reads for too long
+bool CoroutineScheduler::isStalled(Slot& slot) {
+  return (slot.wait == COROUTINE_WAIT_BODY || slot.wait == COROUTINE_WAIT_WRITABLE) &&
+         millis() - slot.waitStart >= COROUTINE_IO_TIMEOUT;
+}
+
+void CoroutineScheduler::run() {
+  for (int i = 0; i < MAX_COROUTINE_HANDLERS; i++) {
+    if (!slots[i].active) continue;
+    if (isReady(slots[i])) {
+      resume(slots[i]);
+    } else if (isStalled(slots[i])) {
+      finish(slots[i]);  // the handler never runs again; its frame is destroyed
+    }
+  }
+}
+
+void CoroutineScheduler::watch(SocketPoller& poller) {
+  for (int i = 0; i < MAX_COROUTINE_HANDLERS; i++) {
+    Slot& slot = slots[i];
+    if (!slot.active) continue;
+    switch (slot.wait) {
+      case COROUTINE_WAIT_TIMER: {
+        unsigned long elapsed = millis() - slot.waitStart;
+        poller.wakeAfter(elapsed >= slot.waitMs ? 0 : slot.waitMs - elapsed, POLL_HTTP);
+        break;
+      }
+      case COROUTINE_WAIT_WRITABLE:
+      case COROUTINE_WAIT_BODY: {
+        if (slot.wait == COROUTINE_WAIT_BODY && slot.request.bodyComplete()) {
+          poller.wakeAfter(0, POLL_HTTP);
+          break;
+        }
+        if (slot.wait == COROUTINE_WAIT_WRITABLE) {
+          poller.watchWrite(slot.client.fd(), POLL_HTTP);
+        } else {
+          poller.watchClient(slot.client, POLL_HTTP);
+        }
+        unsigned long elapsed = millis() - slot.waitStart;  // for the timeout
+        poller.wakeAfter(elapsed >= COROUTINE_IO_TIMEOUT ? 0 : COROUTINE_IO_TIMEOUT - elapsed, POLL_HTTP);
+        break;
+      }
+      case COROUTINE_WAIT_YIELD:
+      default:
+        poller.wakeAfter(0, POLL_HTTP);
+        break;
+    }
+  }
+}
+
+void CoroutineScheduler::resume(Slot& slot) {
+  current = &slot;
+  slot.handle.resume();
+  current = nullptr;
+  if (slot.handle.done()) {
+    finish(slot);
+  }
+}
+
+void CoroutineScheduler::finish(Slot& slot) {
+  slot.handle.destroy();
+  slot.client.stop();
+  slot.request.headers = String();  // give the memory back while idle
+  slot.active = false;
+}
+
+uint8_t CoroutineScheduler::running() {
+  uint8_t count = 0;
+  for (int i = 0; i < MAX_COROUTINE_HANDLERS; i++) {
+    if (slots[i].active) count++;
+  }
+  return count;
+}
+
+#endif // WEBSERVER_COROUTINES
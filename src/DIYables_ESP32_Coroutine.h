@@ -0,0 +1,163 @@
+#ifndef ESP32_WIFI_COROUTINE_H
+#define ESP32_WIFI_COROUTINE_H
+
+// Coroutine route handlers (C++20). Compiled only when the toolchain has
+// coroutines (ESP32 Arduino core 3.x, or -std=gnu++20); check with
+// #if WEBSERVER_COROUTINES in sketches that should also build without them.
+// Included by DIYables_ESP32_WebServer.h (needs QueryParams).
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define WEBSERVER_COROUTINES 1
+#endif
+#endif
+#ifndef WEBSERVER_COROUTINES
+#define WEBSERVER_COROUTINES 0
+#endif
+
+#if WEBSERVER_COROUTINES
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <coroutine>
+#include "DIYables_ESP32_Poll.h"
+
+#define MAX_COROUTINE_HANDLERS 4 // Coroutine handlers suspended at the same time
+#define COROUTINE_IO_TIMEOUT 3000 // ms a handler waits for body bytes or send room before it is dropped
+
+class WebServerBase;
+
+// Return type of a coroutine handler. The handler runs right away, up to its
+// first co_await that has to wait; the server resumes it from handleClient().
+class Task {
+public:
+  struct promise_type {
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }  // the server destroys the frame
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+  std::coroutine_handle<promise_type> handle;
+};
+
+// What a suspended handler waits for
+enum CoroutineWait : uint8_t {
+  COROUTINE_WAIT_YIELD,     // next handleClient()
+  COROUTINE_WAIT_TIMER,
+  COROUTINE_WAIT_WRITABLE,  // room in the socket's send buffer
+  COROUTINE_WAIT_BODY       // request body bytes (or its end)
+};
+// Waiting on the client (body, send room) is limited to COROUTINE_IO_TIMEOUT
+// per co_await; then the handler's frame is destroyed and the connection
+// closed, so stalled clients cannot hold every slot.
+
+class Request;
+
+// co_await request.read(buffer, size): number of body bytes read, 0 at the end of the body
+class BodyAwaiter {
+public:
+  BodyAwaiter(Request& request, uint8_t* buffer, size_t size) : request(request), buffer(buffer), size(size) {}
+  bool await_ready();
+  void await_suspend(std::coroutine_handle<> handle);
+  int await_resume();
+private:
+  Request& request;
+  uint8_t* buffer;
+  size_t size;
+};
+
+// co_await response.writable() / sleepFor(ms) / yieldNow()
+class WaitAwaiter {
+public:
+  WaitAwaiter(CoroutineWait wait, unsigned long ms = 0) : wait(wait), ms(ms) {}
+  bool await_ready();
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+private:
+  CoroutineWait wait;
+  unsigned long ms;
+};
+
+class Request {
+public:
+  String method;
+  String path;
+  String headers;  // request line and headers
+  QueryParams params;
+  size_t contentLength;
+  size_t bodyReceived;
+
+  BodyAwaiter read(uint8_t* buffer, size_t size) { return BodyAwaiter(*this, buffer, size); }
+  bool bodyComplete() const { return bodyReceived >= contentLength; }
+
+private:
+  friend class BodyAwaiter;
+  friend class CoroutineScheduler;
+  WiFiClient* client;
+};
+
+// Writes go straight to the connection (blocking like any WiFiClient write);
+// co_await writable() between large pieces lets the rest of the server run.
+class Response : public Print {
+public:
+  void begin(const char* contentType = "text/html", int statusCode = 200);  // status line and headers
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t* data, size_t length) override;
+  using Print::write;
+
+  WaitAwaiter writable() { return WaitAwaiter(COROUTINE_WAIT_WRITABLE); }
+  bool connected();
+
+private:
+  friend class CoroutineScheduler;
+  WiFiClient* client;
+  WebServerBase* server;
+};
+
+inline WaitAwaiter sleepFor(unsigned long ms) { return WaitAwaiter(COROUTINE_WAIT_TIMER, ms); }
+inline WaitAwaiter yieldNow() { return WaitAwaiter(COROUTINE_WAIT_YIELD); }
+
+typedef Task (*CoroutineHandler)(Request& request, Response& response);
+
+// Runs the suspended coroutine handlers of a server
+class CoroutineScheduler {
+public:
+  CoroutineScheduler();
+
+  // Starts handler; returns true if it suspended and now owns the connection
+  bool start(CoroutineHandler handler, WiFiClient& client, WebServerBase* server,
+             const String& method, const String& path, const String& headers,
+             const QueryParams& params, size_t contentLength);
+  void run();  // resumes the handlers whose wait is over
+  void watch(SocketPoller& poller);  // what run() waits for
+  uint8_t running();
+
+private:
+  struct Slot {
+    WiFiClient client;
+    Request request;
+    Response response;
+    std::coroutine_handle<> handle;
+    CoroutineWait wait;
+    unsigned long waitStart;
+    unsigned long waitMs;
+    bool active;
+  };
+
+  friend class BodyAwaiter;
+  friend class WaitAwaiter;
+
+  bool isReady(Slot& slot);
+  bool isStalled(Slot& slot);
+  void resume(Slot& slot);
+  void finish(Slot& slot);
+
+  Slot slots[MAX_COROUTINE_HANDLERS];
+  static Slot* current;  // slot of the handler being run
+};
+
+#endif // WEBSERVER_COROUTINES
+
+#endif
@@ -0,0 +1,402 @@
+#include "DIYables_ESP32_Deflate.h"
+#include "DIYables_ESP32_Memory.h"
+
+static_assert(DEFLATE_WINDOW_BITS >= 9 && DEFLATE_WINDOW_BITS <= 14, "DEFLATE_WINDOW_BITS must be 9..14");
+
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_NIL 0xFFFF
+
+// Base values and extra bits of the length codes 257..285 and distance codes 0..29 (RFC 1951, 3.2.5)
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                         3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                           257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                           8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                           7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// DeflateEncoder
+
+DeflateEncoder::DeflateEncoder() : window(nullptr), head(nullptr), prev(nullptr), out(nullptr), format(DEFLATE_RAW),
+                                   position(0), end(0), bitBuffer(0), bitCount(0), checksum(0),
+                                   inputBytes(0), outputBytes(0), outputUsed(0) {
+}
+
+DeflateEncoder::~DeflateEncoder() {
+  release();
+}
+
+bool DeflateEncoder::allocate() {
+  if (isAllocated()) return true;
+  window = (uint8_t*)WebServerMemory.allocate(MEMORY_COMPRESSION, 2 * DEFLATE_WINDOW_SIZE);
+  head = (uint16_t*)WebServerMemory.allocate(MEMORY_COMPRESSION, DEFLATE_HASH_SIZE * sizeof(uint16_t));
+  prev = (uint16_t*)WebServerMemory.allocate(MEMORY_COMPRESSION, DEFLATE_WINDOW_SIZE * sizeof(uint16_t));
+  if (window == nullptr || head == nullptr || prev == nullptr) {
+    release();
+    return false;
+  }
+  return true;
+}
+
+void DeflateEncoder::release() {
+  WebServerMemory.release(window);
+  WebServerMemory.release(head);
+  WebServerMemory.release(prev);
+  window = nullptr;
+  head = nullptr;
+  prev = nullptr;
+}
+
+void DeflateEncoder::begin(Print& out, DeflateFormat format) {
+  this->out = &out;
+  this->format = format;
+  position = 0;
+  end = 0;
+  bitBuffer = 0;
+  bitCount = 0;
+  inputBytes = 0;
+  outputBytes = 0;
+  outputUsed = 0;
+  memset(head, 0xFF, DEFLATE_HASH_SIZE * sizeof(uint16_t));  // DEFLATE_NIL
+
+  if (format == DEFLATE_GZIP) {
+    static const uint8_t GZIP_HEADER[10] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 4, 0xFF};  // deflate, no mtime, fastest, unknown OS
+    for (uint8_t i = 0; i < sizeof(GZIP_HEADER); i++) putByte(GZIP_HEADER[i]);
+    checksum = 0;
+  } else if (format == DEFLATE_ZLIB) {
+    uint8_t cmf = 0x08 | ((DEFLATE_WINDOW_BITS - 8) << 4);
+    uint8_t flg = 31 - ((cmf << 8) % 31);  // FLEVEL 0 (fastest), no dictionary
+    putByte(cmf);
+    putByte(flg);
+    checksum = 1;
+  }
+
+  // Everything goes into fixed-Huffman blocks
+  putBits(0, 1);  // BFINAL
+  putBits(1, 2);  // BTYPE = 01
+}
+
+size_t DeflateEncoder::write(const uint8_t* data, size_t length) {
+  if (out == nullptr) return 0;
+
+  if (format == DEFLATE_GZIP) {
+    checksum = crc32(checksum, data, length);
+  } else if (format == DEFLATE_ZLIB) {
+    checksum = adler32(checksum, data, length);
+  }
+  inputBytes += length;
+
+  size_t remaining = length;
+  while (remaining > 0) {
+    if (end == 2 * DEFLATE_WINDOW_SIZE) {
+      compress(false);
+      slide();
+    }
+    size_t n = min(remaining, (size_t)(2 * DEFLATE_WINDOW_SIZE - end));
+    memcpy(window + end, data, n);
+    end += n;
+    data += n;
+    remaining -= n;
+  }
+  return length;
+}
+
+void DeflateEncoder::flush() {
+  if (out == nullptr) return;
+  compress(true);
+
+  // End the fixed block, then an empty stored block brings the stream to a
+  // byte boundary (like zlib's Z_SYNC_FLUSH), then open a new fixed block
+  putCode(0, 7);
+  putBits(0, 1);
+  putBits(0, 2);
+  alignToByte();
+  putByte(0x00);
+  putByte(0x00);
+  putByte(0xFF);
+  putByte(0xFF);
+  flushOutput();
+  putBits(0, 1);
+  putBits(1, 2);
+}
+
+void DeflateEncoder::finish() {
+  if (out == nullptr) return;
+  compress(true);
+
+  putCode(0, 7);  // end of the open block
+  putBits(1, 1);  // empty final block
+  putBits(1, 2);
+  putCode(0, 7);
+  alignToByte();
+
+  if (format == DEFLATE_GZIP) {
+    for (uint8_t i = 0; i < 32; i += 8) putByte(checksum >> i);
+    for (uint8_t i = 0; i < 32; i += 8) putByte(inputBytes >> i);
+  } else if (format == DEFLATE_ZLIB) {
+    for (int8_t i = 24; i >= 0; i -= 8) putByte(checksum >> i);
+  }
+  flushOutput();
+  out = nullptr;
+}
+
+size_t DeflateEncoder::pendingInput(const uint8_t** data) const {
+  *data = window + position;
+  return end - position;
+}
+
+void DeflateEncoder::insertHash(size_t at) {
+  uint16_t hash = ((window[at] << 10) ^ (window[at + 1] << 5) ^ window[at + 2]) & (DEFLATE_HASH_SIZE - 1);
+  prev[at & (DEFLATE_WINDOW_SIZE - 1)] = head[hash];
+  head[hash] = at;
+}
+
+void DeflateEncoder::compress(bool all) {
+  // Keep a full match of lookahead unless this is the last of the input
+  size_t minLookahead = all ? 1 : DEFLATE_MAX_MATCH;
+  while (end - position >= minLookahead) {
+    size_t available = end - position;
+    size_t bestLength = 0;
+    size_t bestDistance = 0;
+
+    if (available >= DEFLATE_MIN_MATCH) {
+      uint16_t hash = ((window[position] << 10) ^ (window[position + 1] << 5) ^ window[position + 2]) & (DEFLATE_HASH_SIZE - 1);
+      uint16_t candidate = head[hash];
+      prev[position & (DEFLATE_WINDOW_SIZE - 1)] = candidate;
+      head[hash] = position;
+
+      size_t maxLength = min(available, (size_t)DEFLATE_MAX_MATCH);
+      const uint8_t* current = window + position;
+      for (uint8_t chain = DEFLATE_MAX_CHAIN; candidate != DEFLATE_NIL && chain > 0; chain--) {
+        size_t distance = position - candidate;
+        // Older candidates may already be overwritten in prev[]
+        if (distance >= DEFLATE_WINDOW_SIZE) break;
+
+        const uint8_t* match = window + candidate;
+        if (match[bestLength] == current[bestLength] && match[0] == current[0]) {
+          size_t length = 1;
+          while (length < maxLength && match[length] == current[length]) length++;
+          if (length > bestLength) {
+            bestLength = length;
+            bestDistance = distance;
+            if (length == maxLength) break;
+          }
+        }
+
+        uint16_t next = prev[candidate & (DEFLATE_WINDOW_SIZE - 1)];
+        if (next >= candidate) break;  // end of the chain (or DEFLATE_NIL)
+        candidate = next;
+      }
+    }
+
+    if (bestLength >= DEFLATE_MIN_MATCH) {
+      putMatch(bestLength, bestDistance);
+      for (size_t at = position + 1; at < position + bestLength && at + DEFLATE_MIN_MATCH <= end; at++) {
+        insertHash(at);
+      }
+      position += bestLength;
+    } else {
+      putLiteral(window[position]);
+      position++;
+    }
+  }
+}
+
+void DeflateEncoder::slide() {
+  // Called with position >= DEFLATE_WINDOW_SIZE: drop the oldest half
+  memcpy(window, window + DEFLATE_WINDOW_SIZE, end - DEFLATE_WINDOW_SIZE);
+  position -= DEFLATE_WINDOW_SIZE;
+  end -= DEFLATE_WINDOW_SIZE;
+  for (size_t i = 0; i < DEFLATE_HASH_SIZE; i++) {
+    head[i] = (head[i] == DEFLATE_NIL || head[i] < DEFLATE_WINDOW_SIZE) ? DEFLATE_NIL : head[i] - DEFLATE_WINDOW_SIZE;
+  }
+  for (size_t i = 0; i < DEFLATE_WINDOW_SIZE; i++) {
+    prev[i] = (prev[i] == DEFLATE_NIL || prev[i] < DEFLATE_WINDOW_SIZE) ? DEFLATE_NIL : prev[i] - DEFLATE_WINDOW_SIZE;
+  }
+}
+
+void DeflateEncoder::putLiteral(uint8_t value) {
+  if (value < 144) {
+    putCode(0x30 + value, 8);
+  } else {
+    putCode(0x190 + value - 144, 9);
+  }
+}
+
+void DeflateEncoder::putMatch(size_t length, size_t distance) {
+  uint8_t code = 28;
+  while (LENGTH_BASE[code] > length) code--;
+  uint16_t symbol = 257 + code;
+  if (symbol < 280) {
+    putCode(symbol - 256, 7);
+  } else {
+    putCode(0xC0 + symbol - 280, 8);
+  }
+  putBits(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+  code = 29;
+  while (DISTANCE_BASE[code] > distance) code--;
+  putCode(code, 5);
+  putBits(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+}
+
+void DeflateEncoder::putCode(uint16_t code, uint8_t bits) {
+  // Huffman codes are sent most significant bit first
+  uint16_t reversed = 0;
+  for (uint8_t i = 0; i < bits; i++) {
+    reversed = (reversed << 1) | (code & 1);
+    code >>= 1;
+  }
+  putBits(reversed, bits);
+}
+
+void DeflateEncoder::putBits(uint32_t value, uint8_t bits) {
+  bitBuffer |= value << bitCount;
+  bitCount += bits;
+  while (bitCount >= 8) {
+    putByte(bitBuffer);
+    bitBuffer >>= 8;
+    bitCount -= 8;
+  }
+}
+
+void DeflateEncoder::alignToByte() {
+  if (bitCount > 0) putBits(0, 8 - bitCount);
+}
+
+void DeflateEncoder::putByte(uint8_t value) {
+  if (outputUsed == sizeof(output)) flushOutput();
+  output[outputUsed++] = value;
+}
+
+void DeflateEncoder::flushOutput() {
+  if (outputUsed == 0) return;
+  out->write(output, outputUsed);
+  outputBytes += outputUsed;
+  outputUsed = 0;
+}
+
+uint32_t DeflateEncoder::crc32(uint32_t crc, const uint8_t* data, size_t length) {
+  // Half-byte table: 64 bytes of flash instead of 1 KB
+  static const uint32_t CRC_TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+    crc = (crc >> 4) ^ CRC_TABLE[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+uint32_t DeflateEncoder::adler32(uint32_t adler, const uint8_t* data, size_t length) {
+  uint32_t a = adler & 0xFFFF;
+  uint32_t b = adler >> 16;
+  while (length > 0) {
+    size_t n = min(length, (size_t)5552);  // largest n before b can overflow
+    length -= n;
+    while (n-- > 0) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return (b << 16) | a;
+}
+
+// CompressedResponse
+
+CompressedResponse::CompressedResponse() : out(nullptr), encoder(nullptr), format(DEFLATE_GZIP), minLength(0), state(IDLE) {
+}
+
+void CompressedResponse::begin(Print& out, DeflateEncoder& encoder, DeflateFormat format, uint32_t minLength) {
+  this->out = &out;
+  this->encoder = &encoder;
+  this->format = format;
+  // The encoder keeps up to two windows of input uncompressed
+  this->minLength = min(minLength, (uint32_t)(2 * DEFLATE_WINDOW_SIZE));
+  chunked.out = &out;
+  encoder.begin(chunked, format);
+  state = PENDING;
+}
+
+size_t CompressedResponse::write(uint8_t data) {
+  return write(&data, 1);
+}
+
+size_t CompressedResponse::write(const uint8_t* data, size_t length) {
+  switch (state) {
+    case PENDING: {
+      // Never let the encoder produce output before the headers are decided
+      size_t below = minLength - encoder->totalIn();
+      if (length < below) {
+        return encoder->write(data, length);
+      }
+      encoder->write(data, below);
+      startCompressed();
+      encoder->write(data + below, length - below);
+      return length;
+    }
+    case COMPRESSED:
+      return encoder->write(data, length);
+    case PLAIN:
+      return out->write(data, length);
+    default:
+      return 0;
+  }
+}
+
+void CompressedResponse::flush() {
+  if (state == PENDING) {
+    startPlain();
+  } else if (state == COMPRESSED) {
+    encoder->flush();
+  }
+}
+
+void CompressedResponse::end() {
+  if (state == PENDING) {
+    startPlain();
+  } else if (state == COMPRESSED) {
+    encoder->finish();
+    out->write((const uint8_t*)"0\r\n\r\n", 5);
+  }
+  state = IDLE;
+}
+
+void CompressedResponse::startCompressed() {
+  out->print(format == DEFLATE_GZIP ? "Content-Encoding: gzip\r\n" : "Content-Encoding: deflate\r\n");
+  out->print("Transfer-Encoding: chunked\r\n\r\n");
+  state = COMPRESSED;
+}
+
+void CompressedResponse::startPlain() {
+  out->print("\r\n");
+  const uint8_t* pending;
+  size_t length = encoder->pendingInput(&pending);
+  if (length > 0) out->write(pending, length);
+  state = PLAIN;
+}
+
+size_t CompressedResponse::ChunkedOutput::write(const uint8_t* data, size_t length) {
+  // Size line, data and CRLF in one write
+  uint8_t frame[DEFLATE_OUTPUT_BUFFER_SIZE + 8];
+  size_t remaining = length;
+  while (remaining > 0) {
+    size_t n = min(remaining, (size_t)DEFLATE_OUTPUT_BUFFER_SIZE);
+    int header = snprintf((char*)frame, sizeof(frame), "%x\r\n", (unsigned int)n);
+    memcpy(frame + header, data, n);
+    frame[header + n] = '\r';
+    frame[header + n + 1] = '\n';
+    out->write(frame, header + n + 2);
+    data += n;
+    remaining -= n;
+  }
+  return length;
+}
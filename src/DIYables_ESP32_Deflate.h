@@ -0,0 +1,114 @@
+#ifndef ESP32_WIFI_DEFLATE_H
+#define ESP32_WIFI_DEFLATE_H
+
+#include <Arduino.h>
+
+#define DEFLATE_WINDOW_BITS 10          // 1 KB history (9..14); RAM used is about 5 << (DEFLATE_WINDOW_BITS - 10) KB
+#define DEFLATE_HASH_BITS 9             // 512 hash chains
+#define DEFLATE_MAX_CHAIN 16            // Candidates tried per position (speed vs. ratio)
+#define DEFLATE_OUTPUT_BUFFER_SIZE 256  // Compressed bytes collected before out.write()
+
+#define DEFLATE_WINDOW_SIZE (1 << DEFLATE_WINDOW_BITS)
+
+enum DeflateFormat : uint8_t {
+  DEFLATE_RAW,   // bare deflate stream
+  DEFLATE_ZLIB,  // RFC 1950, what HTTP calls "deflate"
+  DEFLATE_GZIP   // RFC 1952
+};
+
+// Streaming deflate compressor for a small RAM budget: greedy LZ77 over a
+// DEFLATE_WINDOW_SIZE window with fixed Huffman codes. Input is collected
+// until 2 * DEFLATE_WINDOW_SIZE bytes are buffered (or flush()/finish() is
+// called); nothing is written to `out` before that.
+class DeflateEncoder {
+public:
+  DeflateEncoder();
+  ~DeflateEncoder();
+
+  bool allocate();  // window and hash chains, call once before begin()
+  void release();
+  bool isAllocated() const { return window != nullptr; }
+
+  void begin(Print& out, DeflateFormat format);
+  size_t write(const uint8_t* data, size_t length);
+  void flush();   // sync flush: everything written so far can be decoded by the peer
+  void finish();  // last block and trailer; begin() again for the next stream
+
+  size_t pendingInput(const uint8_t** data) const;  // input not compressed yet
+  uint32_t totalIn() const { return inputBytes; }
+  uint32_t totalOut() const { return outputBytes + outputUsed; }
+
+  static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length);
+  static uint32_t adler32(uint32_t adler, const uint8_t* data, size_t length);
+
+private:
+  void compress(bool all);
+  void slide();
+  void insertHash(size_t position);
+  void putLiteral(uint8_t value);
+  void putMatch(size_t length, size_t distance);
+  void putCode(uint16_t code, uint8_t bits);
+  void putBits(uint32_t value, uint8_t bits);
+  void putByte(uint8_t value);
+  void alignToByte();
+  void flushOutput();
+
+  uint8_t* window;  // 2 * DEFLATE_WINDOW_SIZE: history followed by lookahead
+  uint16_t* head;   // most recent position of each hash
+  uint16_t* prev;   // previous position with the same hash, by position % window size
+  Print* out;
+  DeflateFormat format;
+  size_t position;  // next byte to compress
+  size_t end;       // bytes in window
+  uint32_t bitBuffer;
+  uint8_t bitCount;
+  uint32_t checksum;
+  uint32_t inputBytes;
+  uint32_t outputBytes;
+  uint16_t outputUsed;
+  uint8_t output[DEFLATE_OUTPUT_BUFFER_SIZE];
+};
+
+// Response body stage: compresses what a handler writes and sends it with
+// chunked transfer encoding. The header block is completed by this stage,
+// once it knows whether the body reaches minLength (at most
+// 2 * DEFLATE_WINDOW_SIZE); shorter bodies go out uncompressed.
+class CompressedResponse : public Print {
+public:
+  CompressedResponse();
+
+  // The header block written to `out` so far must not be terminated yet
+  void begin(Print& out, DeflateEncoder& encoder, DeflateFormat format, uint32_t minLength);
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t* data, size_t length) override;
+  using Print::write;
+  void flush() override;  // sends what was written so far (uncompressed if still below minLength)
+  void end();
+
+  bool isActive() const { return state != IDLE; }
+  bool isCompressed() const { return state == COMPRESSED; }
+
+private:
+  enum State : uint8_t { IDLE, PENDING, COMPRESSED, PLAIN };
+
+  // Frames each write as one HTTP chunk
+  class ChunkedOutput : public Print {
+  public:
+    Print* out = nullptr;
+    size_t write(uint8_t data) override { return write(&data, 1); }
+    size_t write(const uint8_t* data, size_t length) override;
+    using Print::write;
+  };
+
+  void startCompressed();
+  void startPlain();
+
+  ChunkedOutput chunked;
+  Print* out;
+  DeflateEncoder* encoder;
+  DeflateFormat format;
+  uint32_t minLength;
+  State state;
+};
+
+#endif
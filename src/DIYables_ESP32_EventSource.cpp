@@ -0,0 +1,245 @@
+#include "DIYables_ESP32_EventSource.h"
+#include "DIYables_ESP32_Memory.h"
+#include "DIYables_ESP32_WebServer.h"
+
+#define EVENT_HISTORY_HEADER 6  // uint32_t id + uint16_t length
+
+DIYables_ESP32_EventSource::DIYables_ESP32_EventSource(const char* path) : path(path), connectHandler(nullptr), lastCheck(0), historyUsed(0) {
+  for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+    clientOpen[i] = false;
+    lastSend[i] = 0;
+  }
+}
+
+void DIYables_ESP32_EventSource::onConnect(EventSourceConnectHandler handler) {
+  connectHandler = handler;
+}
+
+bool DIYables_ESP32_EventSource::accept(WiFiClient& client, const String& request) {
+  int slot = -1;
+  for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+    if (!clientOpen[i]) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot == -1) {
+    client.print("HTTP/1.1 503 Service Unavailable\r\nRetry-After: 5\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    return false;
+  }
+
+  // The stream stays open; browsers reconnect after EVENT_RETRY_MS if it drops
+  char headers[192];
+  int length = snprintf(headers, sizeof(headers),
+                        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                        "Connection: keep-alive\r\n\r\nretry: %d\n\n", EVENT_RETRY_MS);
+  if (client.write((const uint8_t*)headers, length) != (size_t)length) {
+    return false;
+  }
+  client.setNoDelay(true);  // events are small and should not wait for more data
+
+  clients[slot] = client;
+  clientOpen[slot] = true;
+  lastSend[slot] = millis();
+
+  // A reconnecting browser sends the id of the last event it received
+  uint32_t lastEventId = 0;
+  char value[16];
+  if (WebServerBase::findHeader(request, "Last-Event-ID", value, sizeof(value))) {
+    lastEventId = strtoul(value, nullptr, 10);
+    replay(slot, lastEventId);
+  }
+
+  if (connectHandler != nullptr && clientOpen[slot]) {
+    connectHandler(*this, slot, lastEventId);
+  }
+  return true;
+}
+
+void DIYables_ESP32_EventSource::loop() {
+  unsigned long now = millis();
+  if (now - lastCheck < EVENT_CHECK_INTERVAL) return;
+  lastCheck = now;
+
+  for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+    if (!clientOpen[i]) continue;
+
+    // Clients never send anything on an event stream; drop what arrives
+    uint8_t scratch[32];
+    while (clients[i].available() > 0 && clients[i].read(scratch, sizeof(scratch)) > 0) {
+    }
+
+    if (!clients[i].connected()) {
+      clients[i].stop();
+      clientOpen[i] = false;
+    } else if (now - lastSend[i] >= EVENT_KEEPALIVE_INTERVAL) {
+      // Keeps proxies and NAT from timing out an idle stream
+      writeFrame(i, ": keep-alive\n\n", 14);
+    }
+  }
+}
+
+void DIYables_ESP32_EventSource::watch(SocketPoller& poller) {
+  unsigned long now = millis();
+  unsigned long sinceCheck = now - lastCheck;
+  bool open = false;
+  for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+    if (!clientOpen[i]) continue;
+    if (!open && sinceCheck < EVENT_CHECK_INTERVAL) {
+      // loop() would not look yet: sleep until it does
+      poller.wakeAfter(EVENT_CHECK_INTERVAL - sinceCheck, POLL_HTTP);
+      return;
+    }
+    open = true;
+    poller.watchClient(clients[i], POLL_HTTP);  // readable when the browser goes away
+    unsigned long idle = now - lastSend[i];
+    poller.wakeAfter(idle >= EVENT_KEEPALIVE_INTERVAL ? 0 : EVENT_KEEPALIVE_INTERVAL - idle, POLL_HTTP);
+  }
+}
+
+// The name is written on a line of its own; a CR or LF would let it add fields
+static bool isValidEventName(const char* event) {
+  return event == nullptr || strpbrk(event, "\r\n") == nullptr;
+}
+
+bool DIYables_ESP32_EventSource::sendEvent(uint8_t client, uint32_t id, const char* event, const char* data) {
+  if (client >= MAX_EVENT_CLIENTS || !clientOpen[client]) return false;
+  if (!isValidEventName(event)) return false;
+
+  size_t length = formatEvent(nullptr, id, event, data);
+  char stackFrame[EVENT_FRAME_BUFFER_SIZE];
+  char* frame = (length <= sizeof(stackFrame)) ? stackFrame : (char*)WebServerMemory.allocate(MEMORY_EVENTSOURCE, length);
+  if (frame == nullptr) return false;
+  formatEvent(frame, id, event, data);
+
+  bool sent = writeFrame(client, frame, length);
+  if (frame != stackFrame) WebServerMemory.release(frame);
+  return sent;
+}
+
+uint8_t DIYables_ESP32_EventSource::broadcastEvent(uint32_t id, const char* event, const char* data) {
+  if (!isValidEventName(event)) return 0;
+  // Formatted once for all clients
+  size_t length = formatEvent(nullptr, id, event, data);
+  char stackFrame[EVENT_FRAME_BUFFER_SIZE];
+  char* frame = (length <= sizeof(stackFrame)) ? stackFrame : (char*)WebServerMemory.allocate(MEMORY_EVENTSOURCE, length);
+  if (frame == nullptr) return 0;
+  formatEvent(frame, id, event, data);
+
+  if (id != 0) {
+    remember(id, frame, length);
+  }
+
+  uint8_t reached = 0;
+  for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+    if (clientOpen[i] && writeFrame(i, frame, length)) {
+      reached++;
+    }
+  }
+  if (frame != stackFrame) WebServerMemory.release(frame);
+  return reached;
+}
+
+uint8_t DIYables_ESP32_EventSource::connectedClients() {
+  uint8_t count = 0;
+  for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+    if (clientOpen[i]) count++;
+  }
+  return count;
+}
+
+void DIYables_ESP32_EventSource::close() {
+  for (int i = 0; i < MAX_EVENT_CLIENTS; i++) {
+    if (clientOpen[i]) {
+      clients[i].stop();
+      clientOpen[i] = false;
+    }
+  }
+}
+
+size_t DIYables_ESP32_EventSource::formatEvent(char* frame, uint32_t id, const char* event, const char* data) {
+  // With frame == nullptr only the length is computed
+  char idLine[16];
+  size_t length = 0;
+  if (id != 0) {
+    int n = snprintf(idLine, sizeof(idLine), "id: %lu\n", (unsigned long)id);
+    if (frame) memcpy(frame + length, idLine, n);
+    length += n;
+  }
+  if (event != nullptr && event[0] != '\0') {
+    size_t n = strlen(event);
+    if (frame) {
+      memcpy(frame + length, "event: ", 7);
+      memcpy(frame + length + 7, event, n);
+      frame[length + 7 + n] = '\n';
+    }
+    length += 7 + n + 1;
+  }
+
+  // One "data:" field per line of data. CR, LF and CRLF all end a line in
+  // an event stream, so a lone CR must not pass through (it would start a
+  // field of the caller's choosing, e.g. "id:")
+  const char* line = data ? data : "";
+  do {
+    size_t n = strcspn(line, "\r\n");
+    size_t next = n;
+    if (line[next] == '\r') next++;
+    if (line[next] == '\n') next++;
+    if (frame) {
+      memcpy(frame + length, "data: ", 6);
+      memcpy(frame + length + 6, line, n);
+      frame[length + 6 + n] = '\n';
+    }
+    length += 6 + n + 1;
+    line += next;
+  } while (*line != '\0');
+
+  if (frame) frame[length] = '\n';  // blank line ends the event
+  return length + 1;
+}
+
+bool DIYables_ESP32_EventSource::writeFrame(uint8_t client, const char* frame, size_t length) {
+  if (clients[client].write((const uint8_t*)frame, length) != length) {
+    // Peer gone or not reading: give the slot to someone else
+    clients[client].stop();
+    clientOpen[client] = false;
+    return false;
+  }
+  lastSend[client] = millis();
+  return true;
+}
+
+void DIYables_ESP32_EventSource::remember(uint32_t id, const char* frame, size_t length) {
+  size_t entryLength = EVENT_HISTORY_HEADER + length;
+  if (entryLength > EVENT_HISTORY_SIZE) return;
+
+  // Drop the oldest events until the new one fits
+  while (historyUsed + entryLength > EVENT_HISTORY_SIZE) {
+    uint16_t oldest;
+    memcpy(&oldest, history + 4, sizeof(oldest));
+    size_t dropped = EVENT_HISTORY_HEADER + oldest;
+    memmove(history, history + dropped, historyUsed - dropped);
+    historyUsed -= dropped;
+  }
+
+  uint16_t frameLength = length;
+  memcpy(history + historyUsed, &id, sizeof(id));
+  memcpy(history + historyUsed + 4, &frameLength, sizeof(frameLength));
+  memcpy(history + historyUsed + EVENT_HISTORY_HEADER, frame, length);
+  historyUsed += entryLength;
+}
+
+void DIYables_ESP32_EventSource::replay(uint8_t client, uint32_t lastEventId) {
+  // Events older than the history are lost; the connect handler can send a full state instead
+  size_t offset = 0;
+  while (offset < historyUsed && clientOpen[client]) {
+    uint32_t id;
+    uint16_t length;
+    memcpy(&id, history + offset, sizeof(id));
+    memcpy(&length, history + offset + 4, sizeof(length));
+    if (id > lastEventId) {
+      writeFrame(client, (const char*)history + offset + EVENT_HISTORY_HEADER, length);
+    }
+    offset += EVENT_HISTORY_HEADER + length;
+  }
+}
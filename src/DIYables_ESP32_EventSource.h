@@ -0,0 +1,68 @@
+#ifndef ESP32_WIFI_EVENTSOURCE_H
+#define ESP32_WIFI_EVENTSOURCE_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "DIYables_ESP32_Poll.h"
+
+#define MAX_EVENT_CLIENTS 4            // Open Server-Sent Events connections per event source
+#define EVENT_KEEPALIVE_INTERVAL 15000 // ms without an event before a ": keep-alive" comment is sent
+#define EVENT_CHECK_INTERVAL 100       // ms between checks for closed connections
+#define EVENT_HISTORY_SIZE 512         // Bytes of recent events kept for Last-Event-ID resume
+#define EVENT_FRAME_BUFFER_SIZE 192    // Events up to this size are formatted on the stack
+#define EVENT_RETRY_MS 3000            // Reconnection delay suggested to browsers
+
+class DIYables_ESP32_EventSource;
+
+// Called when a client connects, after missed events were replayed.
+// lastEventId is the client's Last-Event-ID (0 for a new client).
+typedef void (*EventSourceConnectHandler)(DIYables_ESP32_EventSource& source, uint8_t client, uint32_t lastEventId);
+
+// Server-Sent Events (text/event-stream) endpoint on the HTTP port.
+// Register it with DIYables_ESP32_WebServer::addEventSource(); the server
+// hands over matching requests and keeps the connections alive.
+//
+//   DIYables_ESP32_EventSource events("/events");
+//   server.addEventSource(events);
+//   events.broadcastEvent(++id, "temperature", "23.5");
+//
+// In the browser: new EventSource("/events").addEventListener("temperature", ...)
+class DIYables_ESP32_EventSource {
+public:
+  DIYables_ESP32_EventSource(const char* path);
+
+  const char* getPath() const { return path; }
+  void onConnect(EventSourceConnectHandler handler);
+
+  // id 0 sends no "id:" field. Only broadcast events with an id are kept for
+  // Last-Event-ID resume; an event sent to one client is not replayed.
+  // Event names containing CR or LF are refused (they would start new fields).
+  bool sendEvent(uint8_t client, uint32_t id, const char* event, const char* data);
+  uint8_t broadcastEvent(uint32_t id, const char* event, const char* data);  // returns the clients reached
+  uint8_t connectedClients();
+  void close();
+
+  // Used by the web server
+  bool accept(WiFiClient& client, const String& request);
+  void loop();  // keep-alive comments and closed connections
+  void watch(SocketPoller& poller);  // what loop() waits for
+
+private:
+  size_t formatEvent(char* frame, uint32_t id, const char* event, const char* data);
+  bool writeFrame(uint8_t client, const char* frame, size_t length);
+  void remember(uint32_t id, const char* frame, size_t length);
+  void replay(uint8_t client, uint32_t lastEventId);
+
+  const char* path;
+  EventSourceConnectHandler connectHandler;
+  WiFiClient clients[MAX_EVENT_CLIENTS];
+  bool clientOpen[MAX_EVENT_CLIENTS];
+  unsigned long lastSend[MAX_EVENT_CLIENTS];
+  unsigned long lastCheck;
+
+  // Recent events, oldest first: [uint32_t id][uint16_t length][frame]...
+  uint8_t history[EVENT_HISTORY_SIZE];
+  size_t historyUsed;
+};
+
+#endif
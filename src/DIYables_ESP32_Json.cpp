@@ -0,0 +1,486 @@
+#include "DIYables_ESP32_Json.h"
+#include <math.h>
+
+static_assert(JSON_MAX_DEPTH <= 31, "JSON_MAX_DEPTH must fit the 32-bit level masks (plus the top level)");
+static_assert(JSON_MAX_TOKEN_LENGTH <= 255, "JSON_MAX_TOKEN_LENGTH must fit in a uint8_t");
+
+// JsonStreamWriter
+
+JsonStreamWriter::JsonStreamWriter(Print& out) : out(out), used(0), depth(0), afterKey(false), hasElements(0), written(0), failed(false) {
+}
+
+JsonStreamWriter::~JsonStreamWriter() {
+  flush();
+}
+
+void JsonStreamWriter::flush() {
+  if (used > 0) {
+    written += out.write((const uint8_t*)buffer, used);
+    used = 0;
+  }
+}
+
+void JsonStreamWriter::put(char c) {
+  if (failed) return;
+  if (used == sizeof(buffer)) flush();
+  buffer[used++] = c;
+}
+
+void JsonStreamWriter::put(const char* text, size_t length) {
+  if (failed) return;
+  while (length > 0) {
+    if (used == sizeof(buffer)) flush();
+    size_t n = min(length, sizeof(buffer) - used);
+    memcpy(buffer + used, text, n);
+    used += n;
+    text += n;
+    length -= n;
+  }
+}
+
+void JsonStreamWriter::putString(const char* text, size_t length) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  put('"');
+  const char* run = text;  // characters that need no escaping are copied in runs
+  for (size_t i = 0; i < length; i++) {
+    uint8_t c = text[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+    put(run, text + i - run);
+    run = text + i + 1;
+    put('\\');
+    switch (c) {
+      case '"': put('"'); break;
+      case '\\': put('\\'); break;
+      case '\n': put('n'); break;
+      case '\r': put('r'); break;
+      case '\t': put('t'); break;
+      case '\b': put('b'); break;
+      case '\f': put('f'); break;
+      default:
+        put("u00", 3);
+        put(HEX_DIGITS[c >> 4]);
+        put(HEX_DIGITS[c & 0x0F]);
+        break;
+    }
+  }
+  put(run, text + length - run);
+  put('"');
+}
+
+void JsonStreamWriter::separator() {
+  if (afterKey) {
+    afterKey = false;
+    return;
+  }
+  uint32_t bit = 1UL << depth;
+  if (hasElements & bit) put(',');
+  hasElements |= bit;
+}
+
+JsonStreamWriter& JsonStreamWriter::beginObject() {
+  return beginLevel('{');
+}
+
+JsonStreamWriter& JsonStreamWriter::endObject() {
+  return endLevel('}');
+}
+
+JsonStreamWriter& JsonStreamWriter::beginArray() {
+  return beginLevel('[');
+}
+
+JsonStreamWriter& JsonStreamWriter::endArray() {
+  return endLevel(']');
+}
+
+JsonStreamWriter& JsonStreamWriter::beginLevel(char bracket) {
+  // Deeper levels could not be tracked, and their closing brackets would
+  // no longer match: stop instead of writing a wrong document
+  if (depth >= JSON_MAX_DEPTH) failed = true;
+  separator();
+  put(bracket);
+  if (failed) return *this;
+  depth++;
+  hasElements &= ~(1UL << depth);
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::endLevel(char bracket) {
+  if (depth == 0) {
+    failed = true;
+  } else {
+    depth--;
+  }
+  put(bracket);
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::key(const char* name) {
+  separator();
+  putString(name, strlen(name));
+  put(':');
+  afterKey = true;
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(const char* text) {
+  if (text == nullptr) return nullValue();
+  separator();
+  putString(text, strlen(text));
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(const String& text) {
+  separator();
+  putString(text.c_str(), text.length());
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(bool flag) {
+  separator();
+  if (flag) {
+    put("true", 4);
+  } else {
+    put("false", 5);
+  }
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(int number) {
+  return value((long)number);
+}
+
+JsonStreamWriter& JsonStreamWriter::value(unsigned int number) {
+  return value((unsigned long)number);
+}
+
+JsonStreamWriter& JsonStreamWriter::value(long number) {
+  char text[24];
+  int length = snprintf(text, sizeof(text), "%ld", number);
+  separator();
+  put(text, length);
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(unsigned long number) {
+  char text[24];
+  int length = snprintf(text, sizeof(text), "%lu", number);
+  separator();
+  put(text, length);
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::value(double number, uint8_t decimals) {
+  if (isnan(number) || isinf(number)) return nullValue();
+  char text[32];
+  int length = snprintf(text, sizeof(text), "%.*f", (int)min(decimals, (uint8_t)9), number);
+  if (length <= 0 || length >= (int)sizeof(text)) return nullValue();
+  separator();
+  put(text, length);
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::nullValue() {
+  separator();
+  put("null", 4);
+  return *this;
+}
+
+JsonStreamWriter& JsonStreamWriter::rawValue(const char* json) {
+  separator();
+  put(json, strlen(json));
+  return *this;
+}
+
+// JsonTokenizer
+
+// JSON number grammar (RFC 8259 section 6): no leading zeros, no bare '.'
+// or exponent, no '+' sign; stricter than strtod()
+static bool isJsonNumber(const char* s) {
+  if (*s == '-') s++;
+  if (*s == '0') {
+    s++;
+  } else if (*s >= '1' && *s <= '9') {
+    while (*s >= '0' && *s <= '9') s++;
+  } else {
+    return false;
+  }
+  if (*s == '.') {
+    s++;
+    if (!(*s >= '0' && *s <= '9')) return false;
+    while (*s >= '0' && *s <= '9') s++;
+  }
+  if (*s == 'e' || *s == 'E') {
+    s++;
+    if (*s == '+' || *s == '-') s++;
+    if (!(*s >= '0' && *s <= '9')) return false;
+    while (*s >= '0' && *s <= '9') s++;
+  }
+  return *s == '\0';
+}
+
+JsonTokenizer::JsonTokenizer(JsonEventHandler handler, void* context) : handler(handler), context(context) {
+  reset();
+}
+
+void JsonTokenizer::reset() {
+  state = VALUE;
+  lastError = JSON_OK;
+  stringIsKey = false;
+  depth = 0;
+  objects = 0;
+  tokenLength = 0;
+  token[0] = '\0';
+  literal = nullptr;
+  unicodeDigits = 0;
+  unicode = 0;
+  highSurrogate = 0;
+  consumed = 0;
+}
+
+bool JsonTokenizer::feed(const char* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    if (!step(data[i])) return false;
+    consumed++;
+  }
+  return state != FAILED;
+}
+
+bool JsonTokenizer::finish() {
+  if (state == FAILED) return false;
+  if (state == NUMBER && depth == 0) {
+    if (!step(' ')) return false;  // a top-level number ends with the input
+  }
+  if (state != DONE) return fail(JSON_ERROR_INCOMPLETE);
+  return true;
+}
+
+bool JsonTokenizer::fail(JsonTokenizerError error) {
+  state = FAILED;
+  lastError = error;
+  return false;
+}
+
+void JsonTokenizer::emit(JsonEvent event, uint8_t eventDepth) {
+  token[tokenLength] = '\0';
+  if (handler != nullptr) handler(event, token, tokenLength, eventDepth, context);
+  tokenLength = 0;
+}
+
+bool JsonTokenizer::append(char c) {
+  if (tokenLength >= JSON_MAX_TOKEN_LENGTH) return fail(JSON_ERROR_TOKEN_TOO_LONG);
+  token[tokenLength++] = c;
+  return true;
+}
+
+bool JsonTokenizer::appendCodePoint(uint32_t codePoint) {
+  // UTF-8 encoding of a code point from a \u escape
+  if (codePoint < 0x80) return append(codePoint);
+  if (codePoint < 0x800) {
+    return append(0xC0 | (codePoint >> 6)) && append(0x80 | (codePoint & 0x3F));
+  }
+  if (codePoint < 0x10000) {
+    return append(0xE0 | (codePoint >> 12)) && append(0x80 | ((codePoint >> 6) & 0x3F)) &&
+           append(0x80 | (codePoint & 0x3F));
+  }
+  return append(0xF0 | (codePoint >> 18)) && append(0x80 | ((codePoint >> 12) & 0x3F)) &&
+         append(0x80 | ((codePoint >> 6) & 0x3F)) && append(0x80 | (codePoint & 0x3F));
+}
+
+bool JsonTokenizer::push(bool isObject) {
+  if (depth >= JSON_MAX_DEPTH) return fail(JSON_ERROR_DEPTH);
+  if (isObject) {
+    objects |= (1UL << depth);
+  } else {
+    objects &= ~(1UL << depth);
+  }
+  depth++;
+  return true;
+}
+
+bool JsonTokenizer::pop(bool isObject) {
+  if (depth == 0 || (((objects >> (depth - 1)) & 1) != 0) != isObject) return fail(JSON_ERROR_SYNTAX);
+  depth--;
+  emit(isObject ? JSON_OBJECT_END : JSON_ARRAY_END, depth);
+  valueDone();
+  return true;
+}
+
+void JsonTokenizer::valueDone() {
+  state = (depth == 0) ? DONE : COMMA_OR_END;
+}
+
+bool JsonTokenizer::startValue(char c) {
+  switch (c) {
+    case '{':
+      emit(JSON_OBJECT_START, depth);
+      if (!push(true)) return false;
+      state = KEY_OR_END;
+      return true;
+    case '[':
+      emit(JSON_ARRAY_START, depth);
+      if (!push(false)) return false;
+      state = VALUE_OR_END;
+      return true;
+    case '"':
+      stringIsKey = false;
+      state = STRING;
+      return true;
+    case 't': literal = "true"; break;
+    case 'f': literal = "false"; break;
+    case 'n': literal = "null"; break;
+    default:
+      if (c == '-' || (c >= '0' && c <= '9')) {
+        state = NUMBER;
+        return append(c);
+      }
+      return fail(JSON_ERROR_SYNTAX);
+  }
+  state = LITERAL;
+  return append(c);
+}
+
+bool JsonTokenizer::step(char c) {
+  bool whitespace = (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+
+  switch (state) {
+    case VALUE:
+      if (whitespace) return true;
+      return startValue(c);
+
+    case VALUE_OR_END:
+      if (whitespace) return true;
+      if (c == ']') return pop(false);
+      return startValue(c);
+
+    case KEY_OR_END:
+      if (whitespace) return true;
+      if (c == '}') return pop(true);
+      // fall through
+    case KEY:
+      if (whitespace) return true;
+      if (c != '"') return fail(JSON_ERROR_SYNTAX);
+      stringIsKey = true;
+      state = STRING;
+      return true;
+
+    case COLON:
+      if (whitespace) return true;
+      if (c != ':') return fail(JSON_ERROR_SYNTAX);
+      state = VALUE;
+      return true;
+
+    case COMMA_OR_END: {
+      if (whitespace) return true;
+      bool inObject = (objects >> (depth - 1)) & 1;
+      if (c == ',') {
+        state = inObject ? KEY : VALUE;
+        return true;
+      }
+      if (c == '}' || c == ']') return pop(c == '}');
+      return fail(JSON_ERROR_SYNTAX);
+    }
+
+    case STRING:
+      if (c == '"') {
+        if (highSurrogate != 0) {  // unpaired high surrogate
+          highSurrogate = 0;
+          if (!appendCodePoint(0xFFFD)) return false;
+        }
+        if (stringIsKey) {
+          emit(JSON_KEY, depth);
+          state = COLON;
+        } else {
+          emit(JSON_STRING, depth);
+          valueDone();
+        }
+        return true;
+      }
+      if (c == '\\') {
+        state = STRING_ESCAPE;
+        return true;
+      }
+      if ((uint8_t)c < 0x20) return fail(JSON_ERROR_SYNTAX);
+      return append(c);
+
+    case STRING_ESCAPE: {
+      state = STRING;
+      char unescaped;
+      switch (c) {
+        case '"': unescaped = '"'; break;
+        case '\\': unescaped = '\\'; break;
+        case '/': unescaped = '/'; break;
+        case 'b': unescaped = '\b'; break;
+        case 'f': unescaped = '\f'; break;
+        case 'n': unescaped = '\n'; break;
+        case 'r': unescaped = '\r'; break;
+        case 't': unescaped = '\t'; break;
+        case 'u':
+          state = STRING_UNICODE;
+          unicode = 0;
+          unicodeDigits = 0;
+          return true;
+        default:
+          return fail(JSON_ERROR_SYNTAX);
+      }
+      return append(unescaped);
+    }
+
+    case STRING_UNICODE: {
+      uint8_t digit;
+      if (c >= '0' && c <= '9') digit = c - '0';
+      else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+      else return fail(JSON_ERROR_SYNTAX);
+      unicode = (unicode << 4) | digit;
+      if (++unicodeDigits < 4) return true;
+
+      state = STRING;
+      if (unicode >= 0xD800 && unicode <= 0xDBFF) {
+        bool replaced = highSurrogate != 0;
+        highSurrogate = unicode;
+        return replaced ? appendCodePoint(0xFFFD) : true;
+      }
+      if (unicode >= 0xDC00 && unicode <= 0xDFFF) {
+        if (highSurrogate == 0) return appendCodePoint(0xFFFD);
+        uint32_t codePoint = 0x10000 + (((uint32_t)highSurrogate - 0xD800) << 10) + (unicode - 0xDC00);
+        highSurrogate = 0;
+        return appendCodePoint(codePoint);
+      }
+      if (highSurrogate != 0) {
+        highSurrogate = 0;
+        if (!appendCodePoint(0xFFFD)) return false;
+      }
+      return appendCodePoint(unicode);
+    }
+
+    case NUMBER:
+      if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+        return append(c);
+      } else {
+        token[tokenLength] = '\0';
+        if (!isJsonNumber(token)) return fail(JSON_ERROR_SYNTAX);
+        emit(JSON_NUMBER, depth);
+        valueDone();
+        return step(c);  // the delimiter belongs to the next token
+      }
+
+    case LITERAL:
+      if (c != literal[tokenLength]) return fail(JSON_ERROR_SYNTAX);
+      append(c);
+      if (literal[tokenLength] == '\0') {
+        emit(literal[0] == 'n' ? JSON_NULL : JSON_BOOL, depth);
+        valueDone();
+      }
+      return true;
+
+    case DONE:
+      if (whitespace) return true;
+      return fail(JSON_ERROR_SYNTAX);
+
+    case FAILED:
+    default:
+      return false;
+  }
+}
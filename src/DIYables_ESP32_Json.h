@@ -0,0 +1,142 @@
+#ifndef ESP32_WIFI_JSON_H
+#define ESP32_WIFI_JSON_H
+
+#include <Arduino.h>
+
+#define JSON_MAX_DEPTH 16          // Nesting levels supported by the writer and the tokenizer (max 31)
+#define JSON_MAX_TOKEN_LENGTH 64   // Longest key/string/number the tokenizer hands to its handler
+#define JSON_WRITER_BUFFER_SIZE 64 // Bytes collected before the writer calls out.write()
+
+// Writes JSON straight to a Print (usually the WiFiClient of a response),
+// without building the document or the response string in RAM.
+//
+//   JsonStreamWriter json(client);
+//   json.beginObject();
+//   json.add("temperature", 23.5);
+//   json.key("leds").beginArray().value(true).value(false).endArray();
+//   json.endObject();
+//   json.flush();  // also done by the destructor
+class JsonStreamWriter {
+public:
+  JsonStreamWriter(Print& out);
+  ~JsonStreamWriter();
+
+  JsonStreamWriter& beginObject();
+  JsonStreamWriter& endObject();
+  JsonStreamWriter& beginArray();
+  JsonStreamWriter& endArray();
+  JsonStreamWriter& key(const char* name);
+
+  JsonStreamWriter& value(const char* text);  // nullptr writes null
+  JsonStreamWriter& value(const String& text);
+  JsonStreamWriter& value(bool flag);
+  JsonStreamWriter& value(int number);
+  JsonStreamWriter& value(unsigned int number);
+  JsonStreamWriter& value(long number);
+  JsonStreamWriter& value(unsigned long number);
+  JsonStreamWriter& value(double number, uint8_t decimals = 2);  // NaN/Inf write null
+  JsonStreamWriter& nullValue();
+  JsonStreamWriter& rawValue(const char* json);  // already serialized JSON
+
+  // key(name).value(v) in one call
+  template <typename T>
+  JsonStreamWriter& add(const char* name, T v) {
+    key(name);
+    return value(v);
+  }
+
+  void flush();
+  size_t bytesWritten() const { return written + used; }
+  // Nesting deeper than JSON_MAX_DEPTH levels, or an end without a begin:
+  // nothing more is written, so the document is visibly cut off
+  bool hasFailed() const { return failed; }
+
+private:
+  void separator();
+  JsonStreamWriter& beginLevel(char bracket);
+  JsonStreamWriter& endLevel(char bracket);
+  void put(char c);
+  void put(const char* text, size_t length);
+  void putString(const char* text, size_t length);
+
+  Print& out;
+  char buffer[JSON_WRITER_BUFFER_SIZE];
+  uint8_t used;
+  uint8_t depth;
+  bool afterKey;
+  uint32_t hasElements;  // bit n: level n already holds an element
+  size_t written;
+  bool failed;
+};
+
+// Events reported by JsonTokenizer
+enum JsonEvent : uint8_t {
+  JSON_OBJECT_START,
+  JSON_OBJECT_END,
+  JSON_ARRAY_START,
+  JSON_ARRAY_END,
+  JSON_KEY,     // value: unescaped key
+  JSON_STRING,  // value: unescaped string
+  JSON_NUMBER,  // value: number as written (use atol/atof)
+  JSON_BOOL,    // value: "true" or "false"
+  JSON_NULL     // value: "null"
+};
+
+enum JsonTokenizerError : uint8_t {
+  JSON_OK,
+  JSON_ERROR_SYNTAX,
+  JSON_ERROR_DEPTH,
+  JSON_ERROR_TOKEN_TOO_LONG,
+  JSON_ERROR_INCOMPLETE  // finish() before the value was complete
+};
+
+// value is NUL-terminated and only valid during the call.
+// depth is the number of objects/arrays enclosing the token.
+typedef void (*JsonEventHandler)(JsonEvent event, const char* value, size_t length, uint8_t depth, void* context);
+
+// Incremental, allocation-free (SAX-style) JSON tokenizer.
+// Input can be fed in chunks of any size, e.g. as a request body arrives;
+// tokens split across chunks are reassembled in a fixed buffer.
+class JsonTokenizer {
+public:
+  JsonTokenizer(JsonEventHandler handler, void* context = nullptr);
+
+  void reset();
+  bool feed(const char* data, size_t length);  // false once an error occurred
+  bool finish();                               // true if one complete value was read
+  JsonTokenizerError error() const { return lastError; }
+  size_t position() const { return consumed; }  // bytes accepted so far
+
+private:
+  enum State : uint8_t {
+    VALUE, VALUE_OR_END, KEY, KEY_OR_END, COLON, COMMA_OR_END,
+    STRING, STRING_ESCAPE, STRING_UNICODE, NUMBER, LITERAL, DONE, FAILED
+  };
+
+  bool step(char c);
+  bool startValue(char c);
+  void valueDone();
+  bool push(bool isObject);
+  bool pop(bool isObject);
+  bool append(char c);
+  bool appendCodePoint(uint32_t codePoint);
+  void emit(JsonEvent event, uint8_t eventDepth);
+  bool fail(JsonTokenizerError error);
+
+  JsonEventHandler handler;
+  void* context;
+  State state;
+  JsonTokenizerError lastError;
+  bool stringIsKey;
+  uint8_t depth;
+  uint32_t objects;  // bit n: level n is an object (else an array)
+  char token[JSON_MAX_TOKEN_LENGTH + 1];
+  uint8_t tokenLength;
+  const char* literal;  // "true", "false" or "null" while in LITERAL
+  uint8_t unicodeDigits;
+  uint16_t unicode;
+  uint16_t highSurrogate;
+  size_t consumed;
+};
+
+#endif
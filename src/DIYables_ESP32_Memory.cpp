@@ -0,0 +1,210 @@
+#include "DIYables_ESP32_Memory.h"
+#include "DIYables_ESP32_Metrics.h"
+
+DIYables_ESP32_Memory WebServerMemory;
+
+static const char* const SUBSYSTEM_NAMES[MEMORY_SUBSYSTEM_COUNT] = {
+  "http", "handler", "websocket", "eventsource", "compression", "trace"
+};
+
+// Put in front of every tagged block; keeps the block aligned like malloc()
+union MemoryHeader {
+  struct {
+    uint32_t size;
+    uint8_t subsystem;
+  } info;
+  max_align_t align;
+};
+
+// Heap kept by scopes that ended inside the current one, so an HTTP request
+// is not charged again for what its handler kept
+static int32_t nestedRetained = 0;
+
+DIYables_ESP32_Memory::DIYables_ESP32_Memory()
+  : largestFreeBlockMin(UINT32_MAX), measuring(false), reportOut(nullptr), reportInterval(0), lastReport(0) {
+  memset(usage, 0, sizeof(usage));
+}
+
+void DIYables_ESP32_Memory::begin() {
+  measuring = true;
+  sampleLargestBlock();
+}
+
+void DIYables_ESP32_Memory::end() {
+  measuring = false;
+}
+
+void* DIYables_ESP32_Memory::allocate(MemorySubsystem subsystem, size_t size) {
+  MemoryHeader* header = (MemoryHeader*)malloc(sizeof(MemoryHeader) + size);
+  if (header == nullptr) {
+    usage[subsystem].failures++;
+    sampleLargestBlock();
+    return nullptr;
+  }
+  header->info.size = size;
+  header->info.subsystem = subsystem;
+  usage[subsystem].allocations++;
+  charge(subsystem, size);
+  return header + 1;
+}
+
+void DIYables_ESP32_Memory::release(void* block) {
+  if (block == nullptr) return;
+  MemoryHeader* header = (MemoryHeader*)block - 1;
+  credit((MemorySubsystem)header->info.subsystem, header->info.size);
+  free(header);
+}
+
+void DIYables_ESP32_Memory::charge(MemorySubsystem subsystem, uint32_t bytes) {
+  MemoryUsage& entry = usage[subsystem];
+  entry.current += bytes;
+  if (entry.current > entry.peak) {
+    entry.peak = entry.current;
+  }
+}
+
+void DIYables_ESP32_Memory::credit(MemorySubsystem subsystem, uint32_t bytes) {
+  MemoryUsage& entry = usage[subsystem];
+  entry.current = (entry.current > bytes) ? entry.current - bytes : 0;
+}
+
+uint32_t DIYables_ESP32_Memory::heapUsed() {
+  return ESP.getHeapSize() - ESP.getFreeHeap();
+}
+
+void DIYables_ESP32_Memory::sampleLargestBlock() {
+  uint32_t largest = ESP.getMaxAllocHeap();
+  if (largest < largestFreeBlockMin) {
+    largestFreeBlockMin = largest;
+  }
+}
+
+void DIYables_ESP32_Memory::getSnapshot(MemorySnapshot& snapshot) {
+  sampleLargestBlock();
+  snapshot.heapSize = ESP.getHeapSize();
+  snapshot.heapFree = ESP.getFreeHeap();
+  snapshot.heapMinFree = ESP.getMinFreeHeap();
+  snapshot.largestFreeBlock = ESP.getMaxAllocHeap();
+  snapshot.largestFreeBlockMin = largestFreeBlockMin;
+#if defined(HOST_BUILD)
+  snapshot.stackFree = 0;
+#else
+  snapshot.stackFree = uxTaskGetStackHighWaterMark(nullptr);  // bytes on ESP-IDF
+#endif
+  memcpy(snapshot.subsystems, usage, sizeof(usage));
+}
+
+void DIYables_ESP32_Memory::resetPeaks() {
+  for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+    usage[i].peak = usage[i].current;
+  }
+  largestFreeBlockMin = UINT32_MAX;
+  sampleLargestBlock();
+}
+
+void DIYables_ESP32_Memory::writeReport(Print& out) {
+  MemorySnapshot snapshot;
+  getSnapshot(snapshot);
+
+  char line[128];
+  snprintf(line, sizeof(line), "heap: free %lu (min %lu) of %lu, largest block %lu (min %lu), stack free %lu\n",
+           (unsigned long)snapshot.heapFree, (unsigned long)snapshot.heapMinFree, (unsigned long)snapshot.heapSize,
+           (unsigned long)snapshot.largestFreeBlock, (unsigned long)snapshot.largestFreeBlockMin,
+           (unsigned long)snapshot.stackFree);
+  out.print(line);
+  for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+    const MemoryUsage& entry = snapshot.subsystems[i];
+    snprintf(line, sizeof(line), "  %-12s current %lu, peak %lu, allocations %lu, failures %lu\n",
+             SUBSYSTEM_NAMES[i], (unsigned long)entry.current, (unsigned long)entry.peak,
+             (unsigned long)entry.allocations, (unsigned long)entry.failures);
+    out.print(line);
+  }
+}
+
+void DIYables_ESP32_Memory::writePrometheus(Print& out) {
+  MemorySnapshot snapshot;
+  getSnapshot(snapshot);
+
+  writePrometheusHeader(out, "memory_heap_free_bytes", "gauge", "Free heap.");
+  writePrometheusValue(out, "memory_heap_free_bytes", "", snapshot.heapFree);
+  writePrometheusHeader(out, "memory_heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+  writePrometheusValue(out, "memory_heap_min_free_bytes", "", snapshot.heapMinFree);
+  writePrometheusHeader(out, "memory_largest_free_block_bytes", "gauge", "Largest allocatable block, now and lowest seen.");
+  writePrometheusValue(out, "memory_largest_free_block_bytes", "", snapshot.largestFreeBlock);
+  writePrometheusValue(out, "memory_largest_free_block_bytes", "when=\"min\"", snapshot.largestFreeBlockMin);
+  writePrometheusHeader(out, "memory_stack_free_bytes", "gauge", "Unused loop task stack at its deepest.");
+  writePrometheusValue(out, "memory_stack_free_bytes", "", snapshot.stackFree);
+
+  char labels[48];
+  writePrometheusHeader(out, "memory_subsystem_bytes", "gauge", "Heap charged to each library subsystem, current and peak.");
+  for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+    snprintf(labels, sizeof(labels), "subsystem=\"%s\"", SUBSYSTEM_NAMES[i]);
+    writePrometheusValue(out, "memory_subsystem_bytes", labels, snapshot.subsystems[i].current);
+    snprintf(labels, sizeof(labels), "subsystem=\"%s\",when=\"peak\"", SUBSYSTEM_NAMES[i]);
+    writePrometheusValue(out, "memory_subsystem_bytes", labels, snapshot.subsystems[i].peak);
+  }
+  writePrometheusHeader(out, "memory_allocation_failures_total", "counter", "Failed allocations by subsystem.");
+  for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+    snprintf(labels, sizeof(labels), "subsystem=\"%s\"", SUBSYSTEM_NAMES[i]);
+    writePrometheusValue(out, "memory_allocation_failures_total", labels, snapshot.subsystems[i].failures);
+  }
+}
+
+void DIYables_ESP32_Memory::setReport(Print& out, unsigned long intervalMs) {
+  if (intervalMs == 0) {
+    reportOut = nullptr;
+    return;
+  }
+  reportOut = &out;
+  reportInterval = intervalMs < MEMORY_REPORT_MIN_INTERVAL ? MEMORY_REPORT_MIN_INTERVAL : intervalMs;
+  lastReport = millis();
+}
+
+void DIYables_ESP32_Memory::loop() {
+  if (reportOut == nullptr) return;
+  unsigned long now = millis();
+  if (now - lastReport < reportInterval) return;
+  lastReport = now;
+  writeReport(*reportOut);
+}
+
+void DIYables_ESP32_Memory::watch(SocketPoller& poller, uint8_t group) {
+  if (reportOut == nullptr) return;
+  unsigned long elapsed = millis() - lastReport;
+  poller.wakeAfter(elapsed >= reportInterval ? 0 : reportInterval - elapsed, group);
+}
+
+const char* DIYables_ESP32_Memory::subsystemName(uint8_t subsystem) {
+  return subsystem < MEMORY_SUBSYSTEM_COUNT ? SUBSYSTEM_NAMES[subsystem] : "unknown";
+}
+
+MemoryScope::MemoryScope(MemorySubsystem subsystem)
+  : subsystem(subsystem), active(WebServerMemory.isMeasuring()), usedAtStart(0), nestedAtStart(0) {
+  if (!active) return;
+  usedAtStart = DIYables_ESP32_Memory::heapUsed();
+  nestedAtStart = nestedRetained;
+}
+
+void MemoryScope::sample() {
+  if (!active) return;
+  int32_t delta = (int32_t)(DIYables_ESP32_Memory::heapUsed() - usedAtStart) - (nestedRetained - nestedAtStart);
+  MemoryUsage& entry = WebServerMemory.usage[subsystem];
+  if (delta > 0 && entry.current + (uint32_t)delta > entry.peak) {
+    entry.peak = entry.current + delta;
+  }
+}
+
+MemoryScope::~MemoryScope() {
+  if (!active) return;
+  sample();
+  int32_t retained = (int32_t)(DIYables_ESP32_Memory::heapUsed() - usedAtStart);
+  int32_t own = retained - (nestedRetained - nestedAtStart);
+  if (own > 0) {
+    WebServerMemory.charge(subsystem, own);
+  } else if (own < 0) {
+    WebServerMemory.credit(subsystem, -own);
+  }
+  WebServerMemory.usage[subsystem].allocations++;  // runs measured
+  nestedRetained = nestedAtStart + retained;
+  WebServerMemory.sampleLargestBlock();
+}
@@ -0,0 +1,138 @@
+#ifndef ESP32_WIFI_MEMORY_H
+#define ESP32_WIFI_MEMORY_H
+
+#include <Arduino.h>
+#include <new>
+#include <utility>
+#include "DIYables_ESP32_Poll.h"
+
+#define MEMORY_REPORT_MIN_INTERVAL 1000 // ms, shortest interval accepted by setReport()
+
+// Parts of the library that memory is charged to
+enum MemorySubsystem : uint8_t {
+  MEMORY_HTTP,         // request line, headers and body Strings in handleClient()
+  MEMORY_HANDLER,      // route and WebSocket message handlers
+  MEMORY_WEBSOCKET,    // WebSocket servers, connections and protocols
+  MEMORY_EVENTSOURCE,  // events too large for the stack frame buffer
+  MEMORY_COMPRESSION,  // deflate window and hash chains
+  MEMORY_TRACE,        // trace ring buffer
+  MEMORY_SUBSYSTEM_COUNT
+};
+
+// Bytes charged to one subsystem. Tagged allocations (WebSocket, event
+// source, compression, trace) are exact. HTTP and handlers allocate through
+// String and user code, so they are measured as heap deltas while
+// WebServerMemory.begin() is active: `current` is what they kept after
+// returning (a steady rise is a leak), `peak` the largest delta seen.
+struct MemoryUsage {
+  uint32_t current;
+  uint32_t peak;
+  uint32_t allocations;  // tagged blocks, or measured runs for HTTP and handlers
+  uint32_t failures;     // allocations that returned nullptr
+};
+
+struct MemorySnapshot {
+  uint32_t heapSize;
+  uint32_t heapFree;
+  uint32_t heapMinFree;          // lowest free heap since boot
+  uint32_t largestFreeBlock;     // biggest single allocation possible now
+  uint32_t largestFreeBlockMin;  // lowest largestFreeBlock seen by the accounting (fragmentation)
+  uint32_t stackFree;            // unused stack of the loop task at its deepest, 0 if unknown
+  MemoryUsage subsystems[MEMORY_SUBSYSTEM_COUNT];
+};
+
+// Heap accounting by subsystem, with an optional periodic report
+// (one line per subsystem) for soak tests:
+//
+//   WebServerMemory.begin();                 // also measure HTTP and handlers
+//   WebServerMemory.setReport(Serial, 60000);
+//   ...
+//   MemorySnapshot memory;
+//   WebServerMemory.getSnapshot(memory);
+class DIYables_ESP32_Memory {
+public:
+  DIYables_ESP32_Memory();
+
+  void begin();  // enables heap-delta measurement of HTTP requests and handlers
+  void end();
+  bool isMeasuring() const { return measuring; }
+
+  // Tagged allocations; the block remembers its size and subsystem
+  void* allocate(MemorySubsystem subsystem, size_t size);
+  void release(void* block);
+
+  template<class T, class... Args>
+  T* create(MemorySubsystem subsystem, Args&&... args) {
+    void* block = allocate(subsystem, sizeof(T));
+    return block != nullptr ? new (block) T(std::forward<Args>(args)...) : nullptr;
+  }
+  template<class T>
+  void destroy(T* object) {
+    if (object == nullptr) return;
+    object->~T();
+    release(object);
+  }
+
+  // Default-constructed objects in one block, for pools
+  template<class T>
+  T* createArray(MemorySubsystem subsystem, size_t count) {
+    T* objects = (T*)allocate(subsystem, count * sizeof(T));
+    if (objects == nullptr) return nullptr;
+    for (size_t i = 0; i < count; i++) new (&objects[i]) T();
+    return objects;
+  }
+  template<class T>
+  void destroyArray(T* objects, size_t count) {
+    if (objects == nullptr) return;
+    for (size_t i = 0; i < count; i++) objects[i].~T();
+    release(objects);
+  }
+
+  void getSnapshot(MemorySnapshot& snapshot);
+  const MemoryUsage& getUsage(MemorySubsystem subsystem) const { return usage[subsystem]; }
+  void resetPeaks();
+
+  void writeReport(Print& out);
+  void writePrometheus(Print& out);  // memory_* gauges, part of the server's /metrics
+  void setReport(Print& out, unsigned long intervalMs);  // 0 stops the report
+  void loop();  // prints the report when due (called by the web server)
+  void watch(SocketPoller& poller, uint8_t group);  // what loop() waits for
+
+  static const char* subsystemName(uint8_t subsystem);
+
+private:
+  friend class MemoryScope;
+
+  static uint32_t heapUsed();
+  void charge(MemorySubsystem subsystem, uint32_t bytes);
+  void credit(MemorySubsystem subsystem, uint32_t bytes);
+  void sampleLargestBlock();
+
+  MemoryUsage usage[MEMORY_SUBSYSTEM_COUNT];
+  uint32_t largestFreeBlockMin;
+  bool measuring;
+  Print* reportOut;
+  unsigned long reportInterval;
+  unsigned long lastReport;
+};
+
+// Charges the heap growth between construction and destruction to a
+// subsystem (only while WebServerMemory.begin() is active). sample() records
+// the delta at a point where the code is at its largest.
+class MemoryScope {
+public:
+  MemoryScope(MemorySubsystem subsystem);
+  ~MemoryScope();
+  void sample();
+
+private:
+  MemorySubsystem subsystem;
+  bool active;
+  uint32_t usedAtStart;
+  int32_t nestedAtStart;
+};
+
+// Shared by the HTTP server, WebSocket servers, event sources and encoders
+extern DIYables_ESP32_Memory WebServerMemory;
+
+#endif
@@ -0,0 +1,156 @@
+#include "DIYables_ESP32_Metrics.h"
+
+static const uint32_t LATENCY_BOUNDS_MS[METRICS_LATENCY_BUCKETS] = METRICS_LATENCY_BOUNDS_MS;
+
+void MetricHistogram::observe(uint32_t ms) {
+  int index = 0;
+  while (index < METRICS_LATENCY_BUCKETS && ms > LATENCY_BOUNDS_MS[index]) {
+    index++;
+  }
+  buckets[index].inc();
+  total.inc();
+  sum.inc(ms);
+}
+
+void MetricHistogram::reset() {
+  for (int i = 0; i <= METRICS_LATENCY_BUCKETS; i++) {
+    buckets[i].reset();
+  }
+  total.reset();
+  sum.reset();
+}
+
+uint32_t MetricHistogram::bound(int index) {
+  return LATENCY_BOUNDS_MS[index];
+}
+
+void HistogramSnapshot::copyFrom(const MetricHistogram& histogram) {
+  for (int i = 0; i <= METRICS_LATENCY_BUCKETS; i++) {
+    buckets[i] = histogram.bucket(i);
+  }
+  count = histogram.count();
+  sumMs = histogram.sumMs();
+}
+
+void WebSocketMetricsSnapshot::copyFrom(const WebSocketMetrics& metrics) {
+  enabled = true;
+  connections = metrics.connections.get();
+  handshakeFailures = metrics.handshakeFailures.get();
+  rejectedFull = metrics.rejectedFull.get();
+  openConnections = metrics.openConnections.get();
+  framesIn = metrics.framesIn.get();
+  framesOut = metrics.framesOut.get();
+  bytesIn = metrics.bytesIn.get();
+  bytesOut = metrics.bytesOut.get();
+  timeouts = metrics.timeouts.get();
+  protocolErrors = metrics.protocolErrors.get();
+  frameLatency.copyFrom(metrics.frameLatency);
+}
+
+void writePrometheusHeader(Print& out, const char* name, const char* type, const char* help) {
+  // Prometheus expects bare '\n' line endings, so println() is not used
+  out.print("# HELP ");
+  out.print(name);
+  out.print(' ');
+  out.print(help);
+  out.print("\n# TYPE ");
+  out.print(name);
+  out.print(' ');
+  out.print(type);
+  out.print('\n');
+}
+
+void writePrometheusValue(Print& out, const char* name, const char* labels, unsigned long value) {
+  // Counters are uint32_t: printed unsigned so they never turn negative past 2^31
+  char line[PROMETHEUS_LINE_SIZE];
+  int length;
+  if (labels[0] != '\0') {
+    length = snprintf(line, sizeof(line), "%s{%s} %lu\n", name, labels, value);
+  } else {
+    length = snprintf(line, sizeof(line), "%s %lu\n", name, value);
+  }
+  if (length > 0) {
+    out.write((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+  }
+}
+
+void writePrometheusSignedValue(Print& out, const char* name, const char* labels, long value) {
+  // Gauges such as open connections may dip below zero for a moment
+  char line[PROMETHEUS_LINE_SIZE];
+  int length;
+  if (labels[0] != '\0') {
+    length = snprintf(line, sizeof(line), "%s{%s} %ld\n", name, labels, value);
+  } else {
+    length = snprintf(line, sizeof(line), "%s %ld\n", name, value);
+  }
+  if (length > 0) {
+    out.write((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+  }
+}
+
+void writePrometheusHistogram(Print& out, const char* name, const char* labels, const HistogramSnapshot& histogram) {
+  const char* separator = labels[0] != '\0' ? "," : "";
+  char line[PROMETHEUS_LINE_SIZE];
+  int length;
+  uint32_t cumulative = 0;
+
+  for (int i = 0; i <= METRICS_LATENCY_BUCKETS; i++) {
+    cumulative += histogram.buckets[i];
+    if (i < METRICS_LATENCY_BUCKETS) {
+      uint32_t bound = LATENCY_BOUNDS_MS[i];
+      length = snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%lu.%03lu\"} %lu\n", name, labels, separator,
+                        (unsigned long)(bound / 1000), (unsigned long)(bound % 1000), (unsigned long)cumulative);
+    } else {
+      length = snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, separator,
+                        (unsigned long)cumulative);
+    }
+    if (length > 0) out.write((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+  }
+
+  // Plain names for sum/count when there are no labels ("name{}" is avoided)
+  const char* open = labels[0] != '\0' ? "{" : "";
+  const char* close = labels[0] != '\0' ? "}" : "";
+  length = snprintf(line, sizeof(line), "%s_sum%s%s%s %lu.%03lu\n", name, open, labels, close,
+                    (unsigned long)(histogram.sumMs / 1000), (unsigned long)(histogram.sumMs % 1000));
+  if (length > 0) out.write((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+  length = snprintf(line, sizeof(line), "%s_count%s%s%s %lu\n", name, open, labels, close,
+                    (unsigned long)histogram.count);
+  if (length > 0) out.write((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+}
+
+void escapePrometheusLabel(char* out, size_t size, const char* value) {
+  size_t length = 0;
+  for (; *value != '\0'; value++) {
+    char c = *value;
+    bool escaped = (c == '\\' || c == '"' || c == '\n');
+    if (length + (escaped ? 2 : 1) >= size) break;
+    if (escaped) out[length++] = '\\';
+    out[length++] = (c == '\n') ? 'n' : c;
+  }
+  out[length] = '\0';
+}
+
+void writePrometheusWebSocket(Print& out, const WebSocketMetricsSnapshot& ws) {
+  if (!ws.enabled) return;
+
+  writePrometheusHeader(out, "websocket_connections_total", "counter", "Accepted WebSocket connections.");
+  writePrometheusValue(out, "websocket_connections_total", "", ws.connections);
+  writePrometheusHeader(out, "websocket_handshake_failures_total", "counter", "Failed WebSocket handshakes.");
+  writePrometheusValue(out, "websocket_handshake_failures_total", "", ws.handshakeFailures);
+  writePrometheusHeader(out, "websocket_rejected_total", "counter", "Connections rejected because all slots were taken.");
+  writePrometheusValue(out, "websocket_rejected_total", "", ws.rejectedFull);
+  writePrometheusHeader(out, "websocket_open_connections", "gauge", "Currently open WebSocket connections.");
+  writePrometheusSignedValue(out, "websocket_open_connections", "", ws.openConnections);
+  writePrometheusHeader(out, "websocket_frames_total", "counter", "WebSocket frames by direction.");
+  writePrometheusValue(out, "websocket_frames_total", "direction=\"in\"", ws.framesIn);
+  writePrometheusValue(out, "websocket_frames_total", "direction=\"out\"", ws.framesOut);
+  writePrometheusHeader(out, "websocket_payload_bytes_total", "counter", "WebSocket payload bytes by direction.");
+  writePrometheusValue(out, "websocket_payload_bytes_total", "direction=\"in\"", ws.bytesIn);
+  writePrometheusValue(out, "websocket_payload_bytes_total", "direction=\"out\"", ws.bytesOut);
+  writePrometheusHeader(out, "websocket_timeouts_total", "counter", "Connections that stalled in the middle of a frame.");
+  writePrometheusValue(out, "websocket_timeouts_total", "", ws.timeouts);
+  writePrometheusHeader(out, "websocket_protocol_errors_total", "counter", "Connections closed because of invalid frames.");
+  writePrometheusValue(out, "websocket_protocol_errors_total", "", ws.protocolErrors);
+  writePrometheusHeader(out, "websocket_frame_duration_seconds", "histogram", "Time spent reading and dispatching one frame.");
+  writePrometheusHistogram(out, "websocket_frame_duration_seconds", "", ws.frameLatency);
+}
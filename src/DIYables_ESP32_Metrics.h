@@ -0,0 +1,185 @@
+#ifndef ESP32_WIFI_METRICS_H
+#define ESP32_WIFI_METRICS_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <atomic>
+
+// Upper bounds (in milliseconds) of the latency histogram buckets.
+// An implicit +Inf bucket follows the last bound.
+#define METRICS_LATENCY_BOUNDS_MS {1, 2, 5, 10, 25, 50, 100, 250, 500, 1000, 2500}
+#define METRICS_LATENCY_BUCKETS 11
+
+// Monotonic counter. Updates are a single relaxed atomic add.
+class MetricCounter {
+public:
+  void inc(uint32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+  uint32_t get() const { return value.load(std::memory_order_relaxed); }
+  void reset() { value.store(0, std::memory_order_relaxed); }
+private:
+  std::atomic<uint32_t> value{0};
+};
+
+// Value that can go up and down (e.g. open connections)
+class MetricGauge {
+public:
+  void set(int32_t v) { value.store(v, std::memory_order_relaxed); }
+  void inc() { value.fetch_add(1, std::memory_order_relaxed); }
+  void dec() { value.fetch_sub(1, std::memory_order_relaxed); }
+  int32_t get() const { return value.load(std::memory_order_relaxed); }
+private:
+  std::atomic<int32_t> value{0};
+};
+
+// Fixed-bucket latency histogram (non-cumulative buckets, cumulated on export)
+class MetricHistogram {
+public:
+  void observe(uint32_t ms);
+  uint32_t count() const { return total.get(); }
+  uint32_t sumMs() const { return sum.get(); }
+  uint32_t bucket(int index) const { return buckets[index].get(); }  // index <= METRICS_LATENCY_BUCKETS
+  void reset();
+
+  static uint32_t bound(int index);  // upper bound in ms of bucket `index`
+private:
+  MetricCounter buckets[METRICS_LATENCY_BUCKETS + 1];
+  MetricCounter total;
+  MetricCounter sum;
+};
+
+// Metrics kept for every registered route (and for "not found")
+struct RouteMetrics {
+  MetricCounter requests;
+  MetricCounter errors;    // responses the server itself answered with 4xx
+  MetricCounter bytesIn;
+  MetricCounter bytesOut;
+  MetricHistogram latency; // from accept to handler return
+};
+
+// Server-wide HTTP metrics
+struct HttpMetrics {
+  MetricCounter connections;     // admitted connections
+  MetricCounter rejectedBusy;    // 503 from the connection cap
+  MetricCounter rejectedRate;    // 429 from the rate limiter
+  MetricCounter authFailures;    // 401 responses
+  MetricCounter timeouts;        // request not complete before REQUEST_TIMEOUT
+  MetricCounter bytesIn;
+  MetricCounter bytesOut;
+};
+
+// Metrics kept by each WebSocket server
+struct WebSocketMetrics {
+  MetricCounter connections;       // successful handshakes
+  MetricCounter handshakeFailures;
+  MetricCounter rejectedFull;      // 503, no free slot
+  MetricGauge openConnections;
+  MetricCounter framesIn;
+  MetricCounter framesOut;
+  MetricCounter bytesIn;           // payload bytes
+  MetricCounter bytesOut;          // payload bytes
+  MetricCounter timeouts;          // endpoint stalled in the middle of a frame
+  MetricCounter protocolErrors;    // connections closed by the server on bad input
+  MetricHistogram frameLatency;    // time spent reading and dispatching one frame
+};
+
+// Plain copy of a histogram
+struct HistogramSnapshot {
+  uint32_t buckets[METRICS_LATENCY_BUCKETS + 1];  // non-cumulative
+  uint32_t count;
+  uint32_t sumMs;
+
+  void copyFrom(const MetricHistogram& histogram);
+};
+
+// Plain copy of WebSocketMetrics
+struct WebSocketMetricsSnapshot {
+  bool enabled;
+  uint32_t connections;
+  uint32_t handshakeFailures;
+  uint32_t rejectedFull;
+  int32_t openConnections;
+  uint32_t framesIn;
+  uint32_t framesOut;
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+  uint32_t timeouts;
+  uint32_t protocolErrors;
+  HistogramSnapshot frameLatency;
+
+  void copyFrom(const WebSocketMetrics& metrics);
+};
+
+// WiFiClient that counts the bytes written through it.
+// Handlers still receive a plain WiFiClient&; writes are virtual, so every
+// print()/write() made by a handler is counted without any change on its side.
+// With timeWrites set, the time spent inside write() is accumulated as well.
+// An optional filter (e.g. a CompressedResponse) can be put in front of the
+// socket: handler writes then go to the filter, which writes to raw().
+class MeteredClient : public WiFiClient {
+public:
+  MeteredClient(const WiFiClient& client, bool timeWrites = false)
+    : WiFiClient(client), rawOutput(*this), filter(nullptr), bytesWritten(0), timeWrites(timeWrites), writeMicros(0), writeCalls(0) {}
+
+  size_t write(uint8_t data) override {
+    if (filter != nullptr) return filter->write(data);
+    return writeRaw(&data, 1);
+  }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    if (filter != nullptr) return filter->write(buffer, size);
+    return writeRaw(buffer, size);
+  }
+  using WiFiClient::write;
+
+  void setFilter(Print* filter) { this->filter = filter; }
+  Print& raw() { return rawOutput; }
+
+  uint32_t getBytesWritten() const { return bytesWritten; }
+  uint32_t getWriteMicros() const { return writeMicros; }
+  uint32_t getWriteCalls() const { return writeCalls; }
+
+private:
+  // Socket side of the filter
+  class RawOutput : public Print {
+  public:
+    RawOutput(MeteredClient& client) : client(client) {}
+    size_t write(uint8_t data) override { return client.writeRaw(&data, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override { return client.writeRaw(buffer, size); }
+    using Print::write;
+  private:
+    MeteredClient& client;
+  };
+
+  size_t writeRaw(const uint8_t* buffer, size_t size) {
+    uint32_t start = timeWrites ? micros() : 0;
+    size_t n = WiFiClient::write(buffer, size);
+    bytesWritten += n;
+    if (timeWrites) addWriteTime(start);
+    return n;
+  }
+  void addWriteTime(uint32_t start) {
+    writeMicros += micros() - start;
+    writeCalls++;
+  }
+
+  RawOutput rawOutput;
+  Print* filter;
+  uint32_t bytesWritten;
+  bool timeWrites;
+  uint32_t writeMicros;
+  uint32_t writeCalls;
+};
+
+// Prometheus text exposition helpers
+// labels: e.g. "route=\"/\"" or "" for none
+#define PROMETHEUS_LINE_SIZE 192  // longest sample line written
+void writePrometheusHeader(Print& out, const char* name, const char* type, const char* help);
+void writePrometheusValue(Print& out, const char* name, const char* labels, unsigned long value);
+// Signed variant for gauges; a separate name keeps uint32_t arguments unambiguous
+void writePrometheusSignedValue(Print& out, const char* name, const char* labels, long value);
+// Copies value with '\', '"' and newlines escaped, for use inside label="..."
+// (out needs up to twice the length of value, plus the terminator)
+void escapePrometheusLabel(char* out, size_t size, const char* value);
+void writePrometheusHistogram(Print& out, const char* name, const char* labels, const HistogramSnapshot& histogram);
+void writePrometheusWebSocket(Print& out, const WebSocketMetricsSnapshot& snapshot);
+
+#endif
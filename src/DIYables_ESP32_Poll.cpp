@@ -0,0 +1,114 @@
+#include "DIYables_ESP32_Poll.h"
+
+#include <sys/select.h>
+
+SocketPoller::SocketPoller() : entryCount(0), timeout(0), readyGroups(0), timerGroups(0) {
+}
+
+void SocketPoller::begin(unsigned long timeoutMs) {
+  entryCount = 0;
+  timeout = timeoutMs;
+  readyGroups = 0;
+  timerGroups = 0;
+}
+
+void SocketPoller::watchRead(int fd, uint8_t group) {
+  if (fd < 0) return;
+  if (fd >= FD_SETSIZE) {
+    wakeAfter(POLL_FALLBACK_INTERVAL, group);  // outside fd_set: look again soon instead
+    return;
+  }
+  if (entryCount == POLL_MAX_SOCKETS) {
+    wakeAfter(0, group);  // cannot wait on it, so do not wait at all
+    return;
+  }
+  entries[entryCount++] = {fd, false, group};
+}
+
+void SocketPoller::watchWrite(int fd, uint8_t group) {
+  if (fd < 0) return;
+  if (fd >= FD_SETSIZE) {
+    wakeAfter(POLL_FALLBACK_INTERVAL, group);  // outside fd_set: look again soon instead
+    return;
+  }
+  if (entryCount == POLL_MAX_SOCKETS) {
+    wakeAfter(0, group);
+    return;
+  }
+  entries[entryCount++] = {fd, true, group};
+}
+
+void SocketPoller::watchClient(WiFiClient& client, uint8_t group) {
+  // WiFiClient reads ahead into its own buffer, which select() cannot see
+  if (client.available() > 0) {
+    readyGroups |= group;
+  } else {
+    watchRead(client.fd(), group);
+  }
+}
+
+void SocketPoller::watchServer(WiFiServer& server, uint8_t group) {
+#if defined(HOST_BUILD)
+  watchRead(server.fd(), group);
+#else
+  // The ESP32 WiFiServer keeps its socket to itself: look again every few ms
+  if (server.hasClient()) {
+    readyGroups |= group;
+  } else {
+    wakeAfter(POLL_ACCEPT_INTERVAL, group);
+  }
+#endif
+}
+
+void SocketPoller::wakeAfter(unsigned long ms, uint8_t group) {
+  if (ms == 0) {
+    readyGroups |= group;
+    return;
+  }
+  int index = (group == POLL_HTTP) ? 0 : 1;
+  if (!(timerGroups & group) || ms < timerMs[index]) {
+    timerMs[index] = ms;
+    timerGroups |= group;
+  }
+  if (ms < timeout) timeout = ms;
+}
+
+uint8_t SocketPoller::wait() {
+  fd_set readSet;
+  fd_set writeSet;
+  FD_ZERO(&readSet);
+  FD_ZERO(&writeSet);
+  int maxFd = -1;
+  for (uint8_t i = 0; i < entryCount; i++) {
+    FD_SET(entries[i].fd, entries[i].write ? &writeSet : &readSet);
+    if (entries[i].fd > maxFd) maxFd = entries[i].fd;
+  }
+
+  // Something is ready already: only collect the sockets that are too
+  struct timeval waitTime;
+  unsigned long waitMs = readyGroups ? 0 : timeout;
+  waitTime.tv_sec = waitMs / 1000;
+  waitTime.tv_usec = (waitMs % 1000) * 1000;
+
+  unsigned long start = millis();
+  int ready = 0;
+  if (maxFd >= 0) {
+    ready = select(maxFd + 1, &readSet, &writeSet, nullptr, &waitTime);
+  } else if (waitMs > 0) {
+    delay(waitMs);
+  }
+
+  uint8_t groups = readyGroups;
+  if (ready > 0) {
+    for (uint8_t i = 0; i < entryCount; i++) {
+      if (FD_ISSET(entries[i].fd, entries[i].write ? &writeSet : &readSet)) {
+        groups |= entries[i].group;
+      }
+    }
+  }
+
+  unsigned long elapsed = millis() - start;
+  if ((timerGroups & POLL_HTTP) && elapsed >= timerMs[0]) groups |= POLL_HTTP;
+  if ((timerGroups & POLL_WEBSOCKET) && elapsed >= timerMs[1]) groups |= POLL_WEBSOCKET;
+  return groups;
+}
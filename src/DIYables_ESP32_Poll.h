@@ -0,0 +1,50 @@
+#ifndef ESP32_WIFI_POLL_H
+#define ESP32_WIFI_POLL_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define POLL_MAX_SOCKETS 24      // Sockets watched by one wait (listening, HTTP, event streams, WebSocket)
+#define POLL_ACCEPT_INTERVAL 10  // ms between hasClient() checks where a listening socket cannot be waited on
+#define POLL_DEFAULT_TIMEOUT 100 // ms DIYables_ESP32_WebServer::poll() sleeps when nothing happens
+#define POLL_FALLBACK_INTERVAL 10 // ms between looks at a socket select() cannot hold (fd >= FD_SETSIZE)
+
+// Parts of the server woken up separately, as bits of SocketPoller::wait()
+enum PollGroup : uint8_t {
+  POLL_HTTP = 0x01,
+  POLL_WEBSOCKET = 0x02
+};
+
+// Waits for readiness on a set of sockets with one select() (lwIP on the
+// ESP32, the kernel on the host build). Each subsystem registers what it is
+// waiting for under its group, then wait() sleeps until one of the sockets is
+// ready, a requested timer expires or the timeout passes.
+class SocketPoller {
+public:
+  SocketPoller();
+
+  void begin(unsigned long timeoutMs);
+  void watchRead(int fd, uint8_t group);
+  void watchWrite(int fd, uint8_t group);
+  void watchClient(WiFiClient& client, uint8_t group);  // data already buffered counts as ready
+  void watchServer(WiFiServer& server, uint8_t group);  // new connections
+  void wakeAfter(unsigned long ms, uint8_t group);
+
+  uint8_t wait();  // groups with something to do (0: timeout)
+
+private:
+  struct Entry {
+    int fd;
+    bool write;
+    uint8_t group;
+  };
+
+  Entry entries[POLL_MAX_SOCKETS];
+  uint8_t entryCount;
+  unsigned long timeout;
+  uint8_t readyGroups;       // ready before waiting (buffered data, pending accept, due timer)
+  unsigned long timerMs[2];  // earliest timer per group
+  uint8_t timerGroups;
+};
+
+#endif
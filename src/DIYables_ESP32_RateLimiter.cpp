@@ -0,0 +1,96 @@
+#include "DIYables_ESP32_RateLimiter.h"
+
+static_assert((RATE_LIMIT_TABLE_SIZE & (RATE_LIMIT_TABLE_SIZE - 1)) == 0,
+              "RATE_LIMIT_TABLE_SIZE must be a power of two");
+
+DIYables_ESP32_RateLimiter::DIYables_ESP32_RateLimiter() : refillPerSecond(0), capacity(0), enabled(false) {
+  reset();
+}
+
+void DIYables_ESP32_RateLimiter::configure(float requestsPerSecond, uint16_t burst) {
+  if (requestsPerSecond <= 0 || burst == 0) {
+    disable();
+    return;
+  }
+  refillPerSecond = (uint32_t)(requestsPerSecond * RATE_LIMIT_TOKEN_SCALE);
+  if (refillPerSecond == 0) refillPerSecond = 1;
+  capacity = (uint32_t)burst * RATE_LIMIT_TOKEN_SCALE;
+  enabled = true;
+  reset();
+}
+
+void DIYables_ESP32_RateLimiter::disable() {
+  enabled = false;
+}
+
+bool DIYables_ESP32_RateLimiter::isEnabled() const {
+  return enabled;
+}
+
+void DIYables_ESP32_RateLimiter::reset() {
+  memset(buckets, 0, sizeof(buckets));
+}
+
+uint32_t DIYables_ESP32_RateLimiter::consume(uint32_t ip, unsigned long now) {
+  if (!enabled) return 0;
+
+  Bucket& bucket = findBucket(ip, now);
+  refill(bucket, now);
+
+  if (bucket.tokens >= RATE_LIMIT_TOKEN_SCALE) {
+    bucket.tokens -= RATE_LIMIT_TOKEN_SCALE;
+    return 0;
+  }
+
+  // Time until one whole token is available, rounded up to full seconds
+  uint32_t missing = RATE_LIMIT_TOKEN_SCALE - bucket.tokens;
+  return (missing + refillPerSecond - 1) / refillPerSecond;
+}
+
+void DIYables_ESP32_RateLimiter::penalize(uint32_t ip, uint16_t tokens, unsigned long now) {
+  if (!enabled) return;
+
+  Bucket& bucket = findBucket(ip, now);
+  refill(bucket, now);
+
+  uint32_t penalty = (uint32_t)tokens * RATE_LIMIT_TOKEN_SCALE;
+  bucket.tokens = (bucket.tokens > penalty) ? bucket.tokens - penalty : 0;
+}
+
+DIYables_ESP32_RateLimiter::Bucket& DIYables_ESP32_RateLimiter::findBucket(uint32_t ip, unsigned long now) {
+  // Fibonacci hashing spreads addresses that differ only in the last octet
+  uint32_t index = (ip * 2654435761u) >> 16;
+  Bucket* victim = nullptr;
+
+  for (int probe = 0; probe < RATE_LIMIT_MAX_PROBES; probe++) {
+    Bucket& bucket = buckets[(index + probe) & (RATE_LIMIT_TABLE_SIZE - 1)];
+    if (bucket.ip == ip) {
+      return bucket;
+    }
+    if (bucket.ip == 0) {
+      victim = &bucket;
+      break;
+    }
+    if (victim == nullptr || (now - bucket.lastRefill) > (now - victim->lastRefill)) {
+      victim = &bucket;
+    }
+  }
+
+  // New client (or evicted stale one) starts with a full bucket
+  victim->ip = ip;
+  victim->tokens = capacity;
+  victim->lastRefill = now;
+  return *victim;
+}
+
+void DIYables_ESP32_RateLimiter::refill(Bucket& bucket, unsigned long now) {
+  unsigned long elapsed = now - bucket.lastRefill;
+  if (elapsed == 0) return;
+
+  uint64_t added = ((uint64_t)elapsed * refillPerSecond) / 1000;
+  if (added == 0) return; // keep lastRefill so partial tokens accumulate
+
+  uint64_t tokens = bucket.tokens + added;
+  bucket.tokens = (tokens > capacity) ? capacity : (uint32_t)tokens;
+  bucket.lastRefill = now;
+}
@@ -0,0 +1,48 @@
+#ifndef ESP32_WIFI_RATELIMITER_H
+#define ESP32_WIFI_RATELIMITER_H
+
+#include <Arduino.h>
+
+#define RATE_LIMIT_TABLE_SIZE 16   // Number of client IPs tracked at once (power of two)
+#define RATE_LIMIT_MAX_PROBES 4    // Slots inspected before evicting the stalest entry
+#define RATE_LIMIT_TOKEN_SCALE 1000 // Buckets store milli-tokens to avoid floating point
+
+// Per-IP token bucket rate limiter.
+// Buckets live in a small fixed-size open-addressing hash table keyed by the
+// client IPv4 address, so the limiter never allocates. When every probed slot
+// is taken, the least recently seen client is evicted.
+class DIYables_ESP32_RateLimiter {
+public:
+  DIYables_ESP32_RateLimiter();
+
+  // requestsPerSecond: sustained refill rate, burst: bucket capacity
+  void configure(float requestsPerSecond, uint16_t burst);
+  void disable();
+  bool isEnabled() const;
+
+  // Takes one token from the bucket of the given client.
+  // Returns 0 when the request is admitted, otherwise the number of seconds
+  // the client should wait before retrying (suitable for Retry-After).
+  uint32_t consume(uint32_t ip, unsigned long now);
+
+  // Removes extra tokens from a client's bucket (e.g. after a failed login)
+  void penalize(uint32_t ip, uint16_t tokens, unsigned long now);
+
+  void reset();
+
+private:
+  struct Bucket {
+    uint32_t ip;            // 0 = empty slot
+    uint32_t tokens;        // milli-tokens
+    unsigned long lastRefill;
+  };
+  Bucket buckets[RATE_LIMIT_TABLE_SIZE];
+  uint32_t refillPerSecond; // milli-tokens added per second
+  uint32_t capacity;        // milli-tokens
+  bool enabled;
+
+  Bucket& findBucket(uint32_t ip, unsigned long now);
+  void refill(Bucket& bucket, unsigned long now);
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include "DIYables_ESP32_Trace.h"
+#include "DIYables_ESP32_Memory.h"
+
+DIYables_ESP32_Trace WebServerTrace;
+
+static const char* const PHASE_NAMES[TRACE_PHASE_COUNT] = {
+  "accept", "headers", "body", "auth", "handler", "write", "close",
+  "ws-handshake", "ws-frame-header", "ws-frame-payload", "ws-dispatch"
+};
+
+DIYables_ESP32_Trace::DIYables_ESP32_Trace() : events(nullptr), capacity(0), head(0), size(0) {
+}
+
+bool DIYables_ESP32_Trace::begin(uint16_t capacity) {
+  end();
+  if (capacity == 0) return false;
+
+  events = (TraceEvent*)WebServerMemory.allocate(MEMORY_TRACE, capacity * sizeof(TraceEvent));
+  if (events == nullptr) return false;
+  this->capacity = capacity;
+  clear();
+  return true;
+}
+
+void DIYables_ESP32_Trace::end() {
+  if (events != nullptr) {
+    WebServerMemory.release(events);
+    events = nullptr;
+  }
+  capacity = 0;
+  head = 0;
+  size = 0;
+}
+
+void DIYables_ESP32_Trace::record(TracePhase phase, uint16_t id, uint32_t start, uint32_t end, uint8_t calls) {
+  if (events == nullptr) return;
+
+  TraceEvent& event = events[head];
+  event.start = start;
+  event.duration = end - start;
+  event.id = id;
+  event.phase = phase;
+  event.calls = calls;
+
+  head = (head + 1) % capacity;
+  if (size < capacity) size++;
+}
+
+void DIYables_ESP32_Trace::clear() {
+  head = 0;
+  size = 0;
+}
+
+const char* DIYables_ESP32_Trace::phaseName(uint8_t phase) {
+  return phase < TRACE_PHASE_COUNT ? PHASE_NAMES[phase] : "unknown";
+}
+
+void DIYables_ESP32_Trace::writeChromeTrace(Print& out) {
+  out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+  // Name the two "threads" so HTTP and WebSocket phases get their own rows
+  out.print("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"http\"}},");
+  out.print("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"websocket\"}}");
+
+  if (events != nullptr) {
+    // Oldest event first
+    uint16_t index = (head + capacity - size) % capacity;
+    char line[160];
+    for (uint16_t i = 0; i < size; i++) {
+      const TraceEvent& event = events[index];
+      bool isWebSocket = event.phase >= TRACE_WS_HANDSHAKE;
+      int length;
+      if (event.phase == TRACE_HTTP_WRITE) {
+        length = snprintf(line, sizeof(line),
+                          ",{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":1,\"args\":{\"request\":%u,\"calls\":%u}}",
+                          phaseName(event.phase), (unsigned long)event.start, (unsigned long)event.duration,
+                          event.id, event.calls);
+      } else {
+        length = snprintf(line, sizeof(line),
+                          ",{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%lu,\"dur\":%lu,\"pid\":1,\"tid\":%d,\"args\":{\"%s\":%u}}",
+                          phaseName(event.phase), isWebSocket ? "websocket" : "http",
+                          (unsigned long)event.start, (unsigned long)event.duration, isWebSocket ? 2 : 1,
+                          isWebSocket ? "slot" : "request", event.id);
+      }
+      if (length > 0) out.write((const uint8_t*)line, min(length, (int)sizeof(line) - 1));
+      index = (index + 1) % capacity;
+    }
+  }
+
+  out.print("]}");
+}
@@ -0,0 +1,65 @@
+#ifndef ESP32_WIFI_TRACE_H
+#define ESP32_WIFI_TRACE_H
+
+#include <Arduino.h>
+
+#define TRACE_DEFAULT_CAPACITY 128 // Events kept in the ring buffer (12 bytes each)
+
+// Phases recorded by the HTTP and WebSocket servers
+enum TracePhase : uint8_t {
+  TRACE_HTTP_ACCEPT,      // server.available() + admission control
+  TRACE_HTTP_HEADERS,     // receiving and parsing the request line and headers
+  TRACE_HTTP_BODY,        // receiving the request body
+  TRACE_HTTP_AUTH,        // Basic authentication check
+  TRACE_HTTP_HANDLER,     // route handler (including its socket writes)
+  TRACE_HTTP_WRITE,       // total time the handler spent in socket writes
+  TRACE_HTTP_CLOSE,       // closing the connection
+  TRACE_WS_HANDSHAKE,     // WebSocketServer::listen() accepting a client
+  TRACE_WS_FRAME_HEADER,  // WebSocket::_readFrame() reading the frame header
+  TRACE_WS_FRAME_PAYLOAD, // WebSocket::_readFrame() reading the payload
+  TRACE_WS_DISPATCH,      // WebSocket::_readFrame() running the frame handler
+  TRACE_PHASE_COUNT
+};
+
+// One completed phase. Times are micros() values.
+struct TraceEvent {
+  uint32_t start;
+  uint32_t duration;
+  uint16_t id;     // request number (HTTP) or connection slot (WebSocket)
+  uint8_t phase;
+  uint8_t calls;   // number of socket writes for TRACE_HTTP_WRITE
+};
+
+// Fixed-size ring buffer of phase timings, dumped as Chrome trace-event JSON
+// (load the output in chrome://tracing or https://ui.perfetto.dev).
+// The buffer is only allocated by begin(); while disabled every hook is a
+// single branch and micros() is not even called.
+class DIYables_ESP32_Trace {
+public:
+  DIYables_ESP32_Trace();
+
+  bool begin(uint16_t capacity = TRACE_DEFAULT_CAPACITY);
+  void end();
+  bool isEnabled() const { return events != nullptr; }
+
+  // Current timestamp, or 0 when tracing is disabled
+  uint32_t stamp() const { return events != nullptr ? micros() : 0; }
+  void record(TracePhase phase, uint16_t id, uint32_t start, uint32_t end, uint8_t calls = 0);
+
+  void clear();
+  uint16_t count() const { return size; }
+  void writeChromeTrace(Print& out);
+
+  static const char* phaseName(uint8_t phase);
+
+private:
+  TraceEvent* events;
+  uint16_t capacity;
+  uint16_t head;  // next slot to write
+  uint16_t size;
+};
+
+// Shared by the HTTP server and every WebSocket server
+extern DIYables_ESP32_Trace WebServerTrace;
+
+#endif
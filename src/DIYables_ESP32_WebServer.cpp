@@ -2,22 +2,64 @@
 #include "DIYables_ESP32_WebSocket.h"
 #include "NotFound_Default.h"
 #include "base64/Base64.h"
+#include "CryptoLegacy/Crypto.h"
+#include <limits.h>
 
-DIYables_ESP32_WebServer::DIYables_ESP32_WebServer(int port) : server(port), routeCount(0), notFoundHandler(nullptr), webSocket(nullptr), authEnabled(false) {
+// Route::compressionMinLength of routes without their own threshold
+#define ROUTE_COMPRESSION_DEFAULT 0xFFFFFFFE
+
+// Content-Length is digits only: -1 for anything else (answered with 400),
+// values too big for an int become INT_MAX (answered with 413)
+static int parseContentLength(const char* value) {
+  if (*value == '\0') return -1;
+  int length = 0;
+  for (const char* c = value; *c != '\0'; c++) {
+    if (*c < '0' || *c > '9') return -1;
+    length = length > (INT_MAX - 9) / 10 ? INT_MAX : length * 10 + (*c - '0');
+  }
+  return length;
+}
+
+WebServerBase::WebServerBase(int port, const Storage& storage) : server(port), webSocket(nullptr), storage(storage), routeCount(0), notFoundHandler(nullptr), authEnabled(false), maxConnections(0) {
   // Initialize authentication variables
-  memset(authUsername, 0, sizeof(authUsername));
-  memset(authPassword, 0, sizeof(authPassword));
-  strcpy(authRealm, "ESP32 Server");
+  authCredentialLength = 0;
+  authRuleCount = 0;
+  metricsPath[0] = '\0';
+  tracePath[0] = '\0';
+  webSocketPath[0] = '\0';
+  serverTimingEnabled = false;
+  requestId = 0;
+  tracedPhases = 0;
+  bodyBytesRead = 0;
+  compressionEnabled = false;
+  compressionMinLength = COMPRESSION_DEFAULT_MIN_LENGTH;
+  responseClient = nullptr;
+  responseFormat = DEFLATE_GZIP;
+  responseMinLength = COMPRESSION_OFF;
+  eventSourceCount = 0;
+  connectionKept = false;
+  deferredGeneration = 0;
+  deferredCheck = 0;
 }
 
-void DIYables_ESP32_WebServer::begin() {
+void WebServerBase::initStorage() {
+  memset(storage.authCredential, 0, storage.maxAuthCredentialLength);
+  strncpy(storage.authRealm, "ESP32 Server", storage.maxAuthRealmLength - 1);
+  storage.authRealm[storage.maxAuthRealmLength - 1] = '\0';
+  for (int i = 0; i < storage.maxDeferredResponses; i++) {
+    storage.deferredSlots[i].generation = 0;
+    storage.deferredSlots[i].postState = DEFERRED_POST_NONE;
+  }
+}
+
+void WebServerBase::begin() {
   // Assume WiFi is already connected, just start the server
   Serial.print("Starting web server on IP: ");
   Serial.println(WiFi.localIP());
   server.begin();
 }
 
-void DIYables_ESP32_WebServer::begin(const char* ssid, const char* pass) {
+void WebServerBase::begin(const char* ssid, const char* pass) {
   Serial.begin(9600);
 
   // Ensure clean WiFi state (prevents issues after code upload)
@@ -37,29 +79,74 @@ void DIYables_ESP32_WebServer::begin(const char* ssid, const char* pass) {
   server.begin();
 }
 
-void DIYables_ESP32_WebServer::addRoute(const char* path, RouteHandler handler) {
-  if (routeCount < MAX_ROUTES) {
-    strncpy(routes[routeCount].path, path, MAX_PATH_LENGTH - 1);
-    routes[routeCount].path[MAX_PATH_LENGTH - 1] = '\0';
-    routes[routeCount].handler = handler;
-    routeCount++;
-  } else {
+void WebServerBase::addRoute(const char* path, RouteHandler handler) {
+  Route* route = addRouteEntry(path);
+  if (route != nullptr) {
+    route->handler = handler;
+  }
+}
+
+#if WEBSERVER_COROUTINES
+void WebServerBase::addRoute(const char* path, CoroutineHandler handler) {
+  Route* route = addRouteEntry(path);
+  if (route != nullptr) {
+    route->coroutine = handler;
+  }
+}
+#endif
+
+WebServerBase::Route* WebServerBase::addRouteEntry(const char* path) {
+  if (routeCount >= storage.maxRoutes) {
     Serial.println("Max routes reached!");
+    return nullptr;
+  }
+  Route* route = &storage.routes[routeCount++];
+  strncpy(route->path, path, MAX_PATH_LENGTH - 1);
+  route->path[MAX_PATH_LENGTH - 1] = '\0';
+  route->handler = nullptr;
+  route->maxBodyLength = DEFAULT_MAX_BODY_LENGTH;
+  route->bodyHandler = nullptr;
+#if WEBSERVER_COROUTINES
+  route->coroutine = nullptr;
+#endif
+  route->compressionMinLength = ROUTE_COMPRESSION_DEFAULT;
+  return route;
+}
+
+
+void WebServerBase::setMaxBodyLength(const char* path, uint32_t maxLength) {
+  for (int i = 0; i < routeCount; i++) {
+    if (strcmp(storage.routes[i].path, path) == 0) {
+      storage.routes[i].maxBodyLength = maxLength;
+      return;
+    }
   }
+  Serial.print("setMaxBodyLength: no route ");
+  Serial.println(path);
 }
 
-void DIYables_ESP32_WebServer::setNotFoundHandler(RouteHandler handler) {
+void WebServerBase::setBodyHandler(const char* path, BodyHandler handler) {
+  Route* route = findRoute(String(path));
+  if (route != nullptr) {
+    route->bodyHandler = handler;
+    return;
+  }
+  Serial.print("setBodyHandler: no route ");
+  Serial.println(path);
+}
+
+void WebServerBase::setNotFoundHandler(RouteHandler handler) {
   notFoundHandler = handler;
 }
 
-void DIYables_ESP32_WebServer::parseQueryString(const String& path, QueryParams& params) {
+void WebServerBase::parseQueryString(const String& path, QueryParams& params) {
   params.count = 0;
   int queryStart = path.indexOf('?');
   if (queryStart == -1) return;
 
   String query = path.substring(queryStart + 1);
   int start = 0;
-  while (start < query.length() && params.count < MAX_QUERY_PARAMS) {
+  while (start < (int)query.length() && params.count < MAX_QUERY_PARAMS) {
     int end = query.indexOf('&', start);
     if (end == -1) end = query.length();
 
@@ -78,12 +165,43 @@ void DIYables_ESP32_WebServer::parseQueryString(const String& path, QueryParams&
   }
 }
 
-void DIYables_ESP32_WebServer::handleClient() {
-  WiFiClient client = server.available();
-  if (client) {
+void WebServerBase::handleClient() {
+  WebServerMemory.loop();
+  for (int i = 0; i < eventSourceCount; i++) {
+    storage.eventSources[i]->loop();
+  }
+  serviceDeferred();
+#if WEBSERVER_COROUTINES
+  coroutines.run();
+#endif
+  
+  uint32_t acceptStart = WebServerTrace.stamp();
+  WiFiClient accepted = server.available();
+  if (accepted) {
+    if (!admitClient(accepted)) {
+      return;
+    }
+    httpMetrics.connections.inc();
+    requestId++;
+    tracedPhases = 0;
+    bodyBytesRead = 0;
+    connectionKept = false;
+    tracePhase(TRACE_HTTP_ACCEPT, acceptStart);
+    uint32_t headersStart = WebServerTrace.stamp();
+    uint32_t bodyStart = 0;
+
+    // Counts every byte written for this request, including by route handlers
+    MeteredClient client(accepted, WebServerTrace.isEnabled());
+    MemoryScope memoryScope(MEMORY_HTTP);  // the request Strings below
+    bool requestHandled = false;
+
     String currentLine = "";
     String request = "";
     String method = "";
+    String path = "";
+    String bodyData = "";
+    QueryParams params;
+    Route* route = nullptr;
     bool currentLineIsBlank = true;
     bool isPost = false;
     bool headersComplete = false;
@@ -99,32 +217,28 @@ void DIYables_ESP32_WebServer::handleClient() {
 
         if (c == '\n' && currentLineIsBlank && !headersComplete) {
           headersComplete = true;
+          tracePhase(TRACE_HTTP_HEADERS, headersStart);
+          bodyStart = WebServerTrace.stamp();
           
           // Parse first line of HTTP request
           String firstLine = request.substring(0, request.indexOf('\n'));
           int start = firstLine.indexOf(' ') + 1;
           int end = firstLine.indexOf(' ', start);
-          String path = firstLine.substring(start, end);
+          path = firstLine.substring(start, end);
           method = firstLine.substring(0, firstLine.indexOf(' '));
 
           // Check if it's a POST request
           isPost = (method == "POST");
 
           // Extract Content-Length for POST requests
-          if (isPost) {
-            int contentLengthIndex = request.indexOf("Content-Length: ");
-            if (contentLengthIndex != -1) {
-              int start = contentLengthIndex + 16;
-              int end = request.indexOf('\r', start);
-              String lengthStr = request.substring(start, end);
-              contentLength = lengthStr.toInt();
-              Serial.print("Content-Length: ");
-              Serial.println(contentLength);
-            }
+          char lengthValue[16];
+          if (isPost && findHeader(request, "Content-Length", lengthValue, sizeof(lengthValue))) {
+            contentLength = parseContentLength(lengthValue);
+            Serial.print("Content-Length: ");
+            Serial.println(contentLength);
           }
 
           // Parse query parameters
-          QueryParams params;
           parseQueryString(path, params);
 
           // Extract path without query string for route matching
@@ -144,46 +258,47 @@ void DIYables_ESP32_WebServer::handleClient() {
             Serial.println(params.params[i].value);
           }
 
-          // For POST requests, continue reading to get the body
-          String jsonData = "";
-          if (isPost && contentLength > 0) {
-            // Continue reading the body
-            continue;
-          } else {
-            // Process the request
-            processRequest(client, method, path, params, jsonData, request);
+          // Route, authentication and body size are checked before any body byte is read
+          if (!screenRequest(client, path, request, isPost ? contentLength : 0, requestStart, route)) {
+            discardInput(client, contentLength < 0 ? REJECTION_DRAIN_LENGTH : contentLength);
+            requestHandled = true;
             break;
           }
-        } else if (headersComplete && isPost && contentLength > 0) {
-          // We're reading the body now
-          static String bodyData = "";
-          bodyData += c;
-          
-          if (bodyData.length() >= contentLength) {
-            String jsonData = bodyData;
-            bodyData = ""; // Reset for next request
-            
-            // Parse first line of HTTP request again
-            String firstLine = request.substring(0, request.indexOf('\n'));
-            int start = firstLine.indexOf(' ') + 1;
-            int end = firstLine.indexOf(' ', start);
-            String path = firstLine.substring(start, end);
-            
-            // Parse query parameters
-            QueryParams params;
-            parseQueryString(path, params);
-            
-            // Extract path without query string for route matching
-            if (path.indexOf('?') != -1) {
-              path = path.substring(0, path.indexOf('?'));
+
+          // The client waits for this before sending the body
+          char expect[16];
+          if (isPost && contentLength > 0 && findHeader(request, "Expect", expect, sizeof(expect)) &&
+              strcasecmp(expect, "100-continue") == 0) {
+            client.print("HTTP/1.1 100 Continue\r\n\r\n");
+          }
+
+#if WEBSERVER_COROUTINES
+          if (route != nullptr && route->coroutine != nullptr) {
+            // The coroutine reads the body itself, with co_await request.read()
+            startCoroutine(client, route, method, path, params, request, isPost ? contentLength : 0, requestStart);
+            requestHandled = true;
+            break;
+          }
+#endif
+
+          // For POST requests, read the body before processing
+          if (isPost && contentLength > 0) {
+            if (!readBody(client, route, path, contentLength, bodyData, requestStart + REQUEST_TIMEOUT)) {
+              break; // timed out or the client went away
             }
+            tracePhase(TRACE_HTTP_BODY, bodyStart);
             
-            Serial.print("JSON body: ");
-            Serial.println(jsonData);
-            
-            processRequest(client, method, path, params, jsonData, request);
-            break;
+            if (bodyData.length() > 0) {
+              Serial.print("JSON body: ");
+              Serial.println(bodyData);
+            }
           }
+          
+          // Process the request
+          memoryScope.sample();  // request, headers and body are all held now
+          processRequest(client, route, method, path, params, bodyData, request, requestStart);
+          requestHandled = true;
+          break;
         }
 
         if (c == '\n') {
@@ -193,44 +308,328 @@ void DIYables_ESP32_WebServer::handleClient() {
         }
       }
     }
+    if (!requestHandled && millis() - requestStart >= REQUEST_TIMEOUT) {
+      httpMetrics.timeouts.inc();
+    }
+    httpMetrics.bytesIn.inc(request.length() + bodyBytesRead);
+    httpMetrics.bytesOut.inc(client.getBytesWritten());
+
+    if (connectionKept) {
+      return; // now owned by an event source or parked
+    }
+    uint32_t closeStart = WebServerTrace.stamp();
     delay(1);
     client.stop();
+    WebServerTrace.record(TRACE_HTTP_CLOSE, requestId, closeStart, WebServerTrace.stamp());
     Serial.println("Client disconnected");
   }
 }
 
-void DIYables_ESP32_WebServer::processRequest(WiFiClient& client, const String& method, const String& path, const QueryParams& params, const String& jsonData, const String& request) {
-  // Check authentication if enabled
-  if (authEnabled && !checkAuthentication(request)) {
-    send401(client);
-    return;
+bool WebServerBase::poll(unsigned long timeoutMs) {
+  SocketPoller poller;
+  poller.begin(timeoutMs);
+  poller.watchServer(server, POLL_HTTP);
+  for (int i = 0; i < eventSourceCount; i++) {
+    storage.eventSources[i]->watch(poller);
   }
-  
-  // Find matching route
-  bool routeFound = false;
+  watchDeferred(poller);
+  WebServerMemory.watch(poller, POLL_HTTP);
+#if WEBSERVER_COROUTINES
+  coroutines.watch(poller);
+#endif
+  if (webSocket != nullptr) {
+    webSocket->watch(poller);
+  }
+
+  // Only the side with something to do is run
+  uint8_t groups = poller.wait();
+  if (groups & POLL_WEBSOCKET) {
+    handleWebSocket();
+  }
+  if (groups & POLL_HTTP) {
+    handleClient();
+  }
+  return groups != 0;
+}
+
+bool WebServerBase::admitClient(WiFiClient& client) {
+  // Global cap on connections held open at the same time (the one being
+  // admitted would be served next)
+  if (maxConnections > 0 && countConnections() >= maxConnections) {
+    httpMetrics.rejectedBusy.inc();
+    sendRejection(client, 503, 1);
+    return false;
+  }
+
+  // Per-IP token bucket
+  if (rateLimiter.isEnabled()) {
+    uint32_t retryAfter = rateLimiter.consume((uint32_t)client.remoteIP(), millis());
+    if (retryAfter > 0) {
+      httpMetrics.rejectedRate.inc();
+      sendRejection(client, 429, retryAfter);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+uint8_t WebServerBase::countConnections() {
+  // Asked from their owners, so connections are counted until they really close
+  uint32_t count = pendingResponses();
+  for (int i = 0; i < eventSourceCount; i++) {
+    count += storage.eventSources[i]->connectedClients();
+  }
+#if WEBSERVER_COROUTINES
+  count += coroutines.running();
+#endif
+  if (webSocket != nullptr && webSocketPath[0] != '\0') {
+    count += webSocket->connectedClients();  // upgraded on this port
+  }
+  return count > 255 ? 255 : count;
+}
+
+void WebServerBase::sendRejection(WiFiClient& client, int statusCode, uint32_t retryAfter) {
+  // Answer with a single write and without parsing the request, so a
+  // misbehaving client costs as little as possible (no logging on purpose)
+  char response[128];
+  int length = snprintf(response, sizeof(response),
+                        "HTTP/1.1 %d %s\r\nRetry-After: %lu\r\nContent-Length: 0\r\nConnection: close\r\n\r\n",
+                        statusCode, statusCode == 429 ? "Too Many Requests" : "Service Unavailable",
+                        (unsigned long)retryAfter);
+  httpMetrics.bytesOut.inc(client.write((const uint8_t*)response, length));
+  // Unread request bytes would turn the close into a reset, which can drop
+  // the answer before the client reads it
+  discardInput(client, REJECTION_DRAIN_LENGTH);
+  client.stop();
+}
+
+WebServerBase::Route* WebServerBase::findRoute(const String& path) {
   for (int i = 0; i < routeCount; i++) {
-    if (path.equals(routes[i].path)) {
-      routes[i].handler(client, method, String(""), params, jsonData);
-      routeFound = true;
-      break;
+    if (path.equals(storage.routes[i].path)) {
+      return &storage.routes[i];
+    }
+  }
+  return nullptr;
+}
+
+DIYables_ESP32_EventSource* WebServerBase::findEventSource(const String& path) {
+  for (int i = 0; i < eventSourceCount; i++) {
+    if (path.equals(storage.eventSources[i]->getPath())) {
+      return storage.eventSources[i];
+    }
+  }
+  return nullptr;
+}
+
+bool WebServerBase::screenRequest(MeteredClient& client, const String& path, const String& request, int contentLength, unsigned long requestStart, Route*& route) {
+  route = findRoute(path);
+  bool builtIn = (metricsPath[0] != '\0' && path.equals(metricsPath)) ||
+                 (tracePath[0] != '\0' && path.equals(tracePath)) ||
+                 (webSocketPath[0] != '\0' && path.equals(webSocketPath)) ||
+                 findEventSource(path) != nullptr;
+  RouteMetrics& metrics = route ? route->metrics : notFoundMetrics;
+  uint32_t bytesBefore = client.getBytesWritten();
+
+  // Check authentication according to the route's policy
+  const AuthRule* rule = findAuthRule(path);
+  AuthPolicy policy = rule ? rule->policy : (authEnabled ? AUTH_BASIC : AUTH_PUBLIC);
+  bool authorized = true;
+  if (policy != AUTH_PUBLIC) {
+    uint32_t authStart = WebServerTrace.stamp();
+    if (policy == AUTH_BASIC) {
+      authorized = checkAuthentication(request);
+    } else {
+      authorized = rule->verifier != nullptr && rule->verifier(path, request);
     }
+    tracePhase(TRACE_HTTP_AUTH, authStart);
   }
 
-  if (!routeFound) {
+  uint32_t handlerStart = WebServerTrace.stamp();
+  if (contentLength < 0) {
+    send400(client);  // the body could not be told from the next request
+  } else if (!authorized) {
+    rateLimiter.penalize((uint32_t)client.remoteIP(), RATE_LIMIT_AUTH_PENALTY, millis());
+    httpMetrics.authFailures.inc();
+    send401(client);
+  } else if (!route && !builtIn) {
+    send404(client);
+  } else if (contentLength > 0 && (uint32_t)contentLength > (route ? route->maxBodyLength : DEFAULT_MAX_BODY_LENGTH)) {
+    send413(client);
+  } else {
+    return true;
+  }
+
+  metrics.errors.inc();
+  finishRequest(client, metrics, request, requestStart, bytesBefore, handlerStart);
+  return false;
+}
+
+void WebServerBase::processRequest(MeteredClient& client, Route* route, const String& method, const String& path, const QueryParams& params, const String& jsonData, const String& request, unsigned long requestStart) {
+  RouteMetrics& metrics = route ? route->metrics : notFoundMetrics;
+  uint32_t bytesBefore = client.getBytesWritten();
+
+  prepareCompression(client, route, request);
+  uint32_t handlerStart = WebServerTrace.stamp();
+  if (route) {
+    MemoryScope memoryScope(MEMORY_HANDLER);
+    route->handler(client, method, String(""), params, jsonData);
+  } else if (metricsPath[0] != '\0' && path.equals(metricsPath)) {
+    sendMetrics(client);
+    endCompression();
+    return; // scrapes are not counted as requests
+  } else if (tracePath[0] != '\0' && path.equals(tracePath)) {
+    sendTrace(client);
+    endCompression();
+    return; // neither are trace dumps
+  } else if (DIYables_ESP32_EventSource* source = findEventSource(path)) {
+    endCompression();
+    connectionKept = source->accept(client, request);
+    return; // nor event streams
+  } else if (webSocketPath[0] != '\0' && path.equals(webSocketPath)) {
+    endCompression();
+    acceptWebSocket(client, method, request);
+    return; // nor WebSocket connections, they have their own metrics
+  } else {
+    metrics.errors.inc();
     send404(client);
   }
+  endCompression();
+
+  finishRequest(client, metrics, request, requestStart, bytesBefore, handlerStart);
+}
+
+#if WEBSERVER_COROUTINES
+void WebServerBase::startCoroutine(MeteredClient& client, Route* route, const String& method, const String& path, const QueryParams& params, const String& request, int contentLength, unsigned long requestStart) {
+  uint32_t bytesBefore = client.getBytesWritten();
+  uint32_t handlerStart = WebServerTrace.stamp();
+  // Measured up to the first suspension; the scheduler owns the connection after that
+  connectionKept = coroutines.start(route->coroutine, client, this, method, path, request, params, contentLength);
+  finishRequest(client, route->metrics, request, requestStart, bytesBefore, handlerStart);
+}
+#endif
+
+void WebServerBase::finishRequest(MeteredClient& client, RouteMetrics& metrics, const String& request, unsigned long requestStart, uint32_t bytesBefore, uint32_t handlerStart) {
+  if (WebServerTrace.isEnabled()) {
+    uint32_t handlerEnd = WebServerTrace.stamp();
+    WebServerTrace.record(TRACE_HTTP_HANDLER, requestId, handlerStart, handlerEnd);
+    // All socket writes of the handler, folded into one event
+    uint32_t writeCalls = client.getWriteCalls();
+    WebServerTrace.record(TRACE_HTTP_WRITE, requestId, handlerStart, handlerStart + client.getWriteMicros(),
+                          writeCalls > 255 ? 255 : writeCalls);
+  }
+
+  metrics.requests.inc();
+  metrics.bytesIn.inc(request.length() + bodyBytesRead);
+  metrics.bytesOut.inc(client.getBytesWritten() - bytesBefore);
+  metrics.latency.observe(millis() - requestStart);
+}
+
+bool WebServerBase::readBody(WiFiClient& client, Route* route, const String& path, int contentLength, String& bodyData, unsigned long deadline) {
+  // Read the body in chunks rather than byte by byte. A route with a body
+  // handler gets each chunk as it arrives and nothing is buffered; otherwise
+  // the chunks are collected into bodyData for the route handler.
+  BodyHandler bodyHandler = route ? route->bodyHandler : nullptr;
+  if (bodyHandler == nullptr) {
+    bodyData.reserve(contentLength);
+  }
+  
+  uint8_t chunk[BODY_CHUNK_SIZE];
+  while ((int)bodyBytesRead < contentLength && (long)(deadline - millis()) > 0) {
+    int available = client.available();
+    if (available <= 0) {
+      if (!client.connected()) return false;
+      delay(1);
+      continue;
+    }
+    
+    int n = client.read(chunk, min(min(available, (int)sizeof(chunk)), contentLength - (int)bodyBytesRead));
+    if (n <= 0) continue;
+    if (bodyHandler != nullptr) {
+      bodyHandler(path, chunk, n, bodyBytesRead, contentLength);
+    } else {
+      bodyData.concat((const char*)chunk, n);
+    }
+    bodyBytesRead += n;
+  }
+  return (int)bodyBytesRead >= contentLength;
 }
 
-void DIYables_ESP32_WebServer::sendResponse(WiFiClient& client, const char* content, const char* contentType) {
-  client.println("HTTP/1.1 200 OK");
+void WebServerBase::discardInput(WiFiClient& client, int maxLength) {
+  // Drop body bytes that already arrived, so closing the socket does not
+  // reset the connection before the client has read the error response
+  uint8_t scratch[64];
+  while (maxLength > 0 && client.available() > 0) {
+    int n = client.read(scratch, min((int)sizeof(scratch), maxLength));
+    if (n <= 0) break;
+    maxLength -= n;
+  }
+}
+
+// Copies the value of a request header, the name is matched case-insensitively
+bool WebServerBase::findHeader(const String& request, const char* name, char* value, size_t size) {
+  net::HeaderField field;
+  const char* line = net::firstHeader(request.c_str());
+  while ((line = net::nextHeader(line, field)) != nullptr) {
+    if (net::isHeader(field, name)) {
+      size_t length = field.valueLength < size ? field.valueLength : size - 1;
+      memcpy(value, field.value, length);
+      value[length] = '\0';
+      return true;
+    }
+  }
+  return false;
+}
+
+static const char* statusText(int statusCode) {
+  switch (statusCode) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 202: return "Accepted";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 415: return "Unsupported Media Type";
+    case 422: return "Unprocessable Entity";
+    case 426: return "Upgrade Required";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "Unknown";
+  }
+}
+
+void WebServerBase::beginResponse(WiFiClient& client, const char* contentType, int statusCode) {
+  char statusLine[48];
+  snprintf(statusLine, sizeof(statusLine), "HTTP/1.1 %d %s", statusCode, statusText(statusCode));
+  client.println(statusLine);
   client.print("Content-Type: ");
   client.println(contentType);
+  printServerTiming(client);
   client.println("Connection: close");
+  
+  // The compression stage ends the header block once it knows the body size
+  if (&client == responseClient && responseMinLength != COMPRESSION_OFF && !compressedResponse.isActive()) {
+    client.println("Vary: Accept-Encoding");
+    compressedResponse.begin(responseClient->raw(), deflateEncoder, responseFormat, responseMinLength);
+    responseClient->setFilter(&compressedResponse);
+    return;
+  }
   client.println();
+}
+
+void WebServerBase::sendResponse(WiFiClient& client, const char* content, const char* contentType) {
+  beginResponse(client, contentType);
   client.print(content);
 }
 
-void DIYables_ESP32_WebServer::send404(WiFiClient& client) {
+void WebServerBase::send404(WiFiClient& client) {
   QueryParams emptyParams;
   emptyParams.count = 0; // Explicitly initialize count
   String emptyJson = "";
@@ -239,15 +638,24 @@ void DIYables_ESP32_WebServer::send404(WiFiClient& client) {
     notFoundHandler(client, emptyMethod, String(""), emptyParams, emptyJson);
   } else {
 	// send the default page
-    client.println("HTTP/1.1 404 Not Found");
-    client.println("Content-Type: text/html");
-    client.println("Connection: close");
-    client.println();
+    beginResponse(client, "text/html", 404);
     client.print(NOT_FOUND_PAGE_DEFAULT);
   }
 }
 
-void DIYables_ESP32_WebServer::printWifiStatus() {
+void WebServerBase::send400(WiFiClient& client) {
+  beginResponse(client, "text/html", 400);
+  client.print("<!DOCTYPE html><html><head><title>400 Bad Request</title></head>");
+  client.print("<body><h1>400 Bad Request</h1></body></html>");
+}
+
+void WebServerBase::send413(WiFiClient& client) {
+  beginResponse(client, "text/html", 413);
+  client.print("<!DOCTYPE html><html><head><title>413 Payload Too Large</title></head>");
+  client.print("<body><h1>413 Payload Too Large</h1></body></html>");
+}
+
+void WebServerBase::printWifiStatus() {
   Serial.print("SSID: ");
   Serial.println(WiFi.SSID());
   long rssi = WiFi.RSSI();
@@ -260,15 +668,171 @@ void DIYables_ESP32_WebServer::printWifiStatus() {
   Serial.println(ip);
 }
 
+// Deferred response methods
+DeferredResponse WebServerBase::deferResponse(WiFiClient& client, unsigned long timeoutMs, int timeoutStatus) {
+  DeferredResponse response = {0, 0};
+  // Only the request being handled can be parked, and only before its response started
+  if (&client != responseClient || compressedResponse.isActive()) {
+    Serial.println("deferResponse: not the client of the current request");
+    return response;
+  }
+  
+  for (int i = 0; i < storage.maxDeferredResponses; i++) {
+    DeferredSlot& slot = storage.deferredSlots[i];
+    if (slot.generation != 0) continue;
+    servicePosted(slot, i);  // drops a late post for the previous request
+    
+    if (++deferredGeneration == 0) deferredGeneration = 1;
+    slot.client = client;
+    slot.start = millis();
+    slot.timeout = timeoutMs;
+    slot.timeoutStatus = timeoutStatus;
+    slot.generation = deferredGeneration;
+    connectionKept = true;
+    
+    response.slot = i;
+    response.generation = slot.generation;
+    return response;
+  }
+  Serial.println("deferResponse: all slots in use");
+  return response;
+}
+
+WebServerBase::DeferredSlot* WebServerBase::findDeferred(DeferredResponse response) {
+  if (!response.isValid() || response.slot >= storage.maxDeferredResponses) return nullptr;
+  DeferredSlot* slot = &storage.deferredSlots[response.slot];
+  return (slot->generation == response.generation) ? slot : nullptr;
+}
+
+bool WebServerBase::isPending(DeferredResponse response) {
+  return findDeferred(response) != nullptr;
+}
+
+WiFiClient* WebServerBase::resumeResponse(DeferredResponse response) {
+  DeferredSlot* slot = findDeferred(response);
+  return slot ? &slot->client : nullptr;
+}
+
+void WebServerBase::finishResponse(DeferredResponse response) {
+  DeferredSlot* slot = findDeferred(response);
+  if (slot == nullptr) return;
+  slot->client.stop();
+  slot->generation = 0;
+}
+
+bool WebServerBase::completeResponse(DeferredResponse response, const char* content, const char* contentType, int statusCode) {
+  DeferredSlot* slot = findDeferred(response);
+  if (slot == nullptr) return false;
+  
+  // The Server-Timing phases belong to the request being handled now, if any
+  uint8_t phases = tracedPhases;
+  tracedPhases = 0;
+  MeteredClient client(slot->client);
+  beginResponse(client, contentType, statusCode);
+  tracedPhases = phases;
+  
+  size_t length = strlen(content);
+  bool sent = client.write((const uint8_t*)content, length) == length;
+  httpMetrics.bytesOut.inc(client.getBytesWritten());
+  finishResponse(response);
+  return sent;
+}
+
+bool WebServerBase::postResponse(DeferredResponse response, const char* content, const char* contentType, int statusCode) {
+  if (!response.isValid() || response.slot >= storage.maxDeferredResponses) return false;
+  DeferredSlot& slot = storage.deferredSlots[response.slot];
+  
+  // Claim the hand-off first: the loop task only reads the fields once they are READY
+  uint8_t expected = DEFERRED_POST_NONE;
+  if (!slot.postState.compare_exchange_strong(expected, DEFERRED_POST_WRITING)) return false;
+  if (slot.generation != response.generation) {
+    slot.postState = DEFERRED_POST_NONE;
+    return false;
+  }
+  slot.postGeneration = response.generation;
+  slot.postContent = content;
+  slot.postContentType = contentType;
+  slot.postStatus = statusCode;
+  slot.postState = DEFERRED_POST_READY;
+  return true;
+}
+
+void WebServerBase::servicePosted(DeferredSlot& slot, uint16_t index) {
+  if (slot.postState != DEFERRED_POST_READY) return;
+  // A post for a request that ended meanwhile (timeout, client gone) is dropped
+  if (slot.generation != 0 && slot.generation == slot.postGeneration) {
+    DeferredResponse response = {index, slot.postGeneration};
+    completeResponse(response, slot.postContent, slot.postContentType, slot.postStatus);
+  }
+  slot.postState = DEFERRED_POST_NONE;
+}
+
+uint16_t WebServerBase::pendingResponses() {
+  uint16_t count = 0;
+  for (int i = 0; i < storage.maxDeferredResponses; i++) {
+    if (storage.deferredSlots[i].generation != 0) count++;
+  }
+  return count;
+}
+
+void WebServerBase::serviceDeferred() {
+  unsigned long now = millis();
+  // Closed connections are looked for every 100 ms, like event streams
+  bool checkConnections = now - deferredCheck >= EVENT_CHECK_INTERVAL;
+  if (checkConnections) deferredCheck = now;
+  
+  for (int i = 0; i < storage.maxDeferredResponses; i++) {
+    DeferredSlot& slot = storage.deferredSlots[i];
+    servicePosted(slot, i);
+    if (slot.generation == 0) continue;
+    
+    DeferredResponse response = {(uint16_t)i, slot.generation};
+    if (now - slot.start >= slot.timeout) {
+      completeResponse(response, "", "text/plain", slot.timeoutStatus);
+    } else if (checkConnections && !slot.client.connected()) {
+      finishResponse(response);
+    }
+  }
+}
+
+void WebServerBase::watchDeferred(SocketPoller& poller) {
+  unsigned long now = millis();
+  unsigned long sinceCheck = now - deferredCheck;
+  for (int i = 0; i < storage.maxDeferredResponses; i++) {
+    DeferredSlot& slot = storage.deferredSlots[i];
+    if (slot.postState == DEFERRED_POST_READY) poller.wakeAfter(0, POLL_HTTP);
+    if (slot.generation == 0) continue;
+    
+    // Other tasks cannot interrupt the wait, so look for their posts regularly
+    unsigned long elapsed = now - slot.start;
+    poller.wakeAfter(elapsed >= slot.timeout ? 0 : slot.timeout - elapsed, POLL_HTTP);
+    poller.wakeAfter(DEFERRED_POST_INTERVAL, POLL_HTTP);
+    if (sinceCheck >= EVENT_CHECK_INTERVAL) {
+      poller.watchRead(slot.client.fd(), POLL_HTTP);  // readable when the client goes away
+    } else {
+      poller.wakeAfter(EVENT_CHECK_INTERVAL - sinceCheck, POLL_HTTP);
+    }
+  }
+}
+
+// Server-Sent Events methods
+void WebServerBase::addEventSource(DIYables_ESP32_EventSource& source) {
+  if (eventSourceCount < storage.maxEventSources) {
+    storage.eventSources[eventSourceCount++] = &source;
+  } else {
+    Serial.println("Max event sources reached!");
+  }
+}
+
 // WebSocket functionality
-DIYables_ESP32_WebSocket* DIYables_ESP32_WebServer::enableWebSocket(uint16_t wsPort) {  
+DIYables_ESP32_WebSocket* WebServerBase::enableWebSocket(uint16_t wsPort) {  
   if (webSocket == nullptr) {
-    webSocket = new DIYables_ESP32_WebSocket(wsPort);
+    webSocket = WebServerMemory.create<DIYables_ESP32_WebSocket>(MEMORY_WEBSOCKET, wsPort);
     
-    if (webSocket->begin()) {
+    if (webSocket != nullptr && webSocket->begin()) {
       return webSocket;
     } else {
-      delete webSocket;
+      WebServerMemory.destroy(webSocket);
       webSocket = nullptr;
       return nullptr;
     }
@@ -277,46 +841,115 @@ DIYables_ESP32_WebSocket* DIYables_ESP32_WebServer::enableWebSocket(uint16_t wsP
   }
 }
 
-DIYables_ESP32_WebSocket* DIYables_ESP32_WebServer::getWebSocket() {
+DIYables_ESP32_WebSocket* WebServerBase::enableWebSocket(const char* path) {
+  if (webSocket != nullptr) {
+    return webSocket;
+  }
+  webSocket = WebServerMemory.create<DIYables_ESP32_WebSocket>(MEMORY_WEBSOCKET, 0);  // no listening socket of its own
+  if (webSocket == nullptr || !webSocket->begin()) {
+    WebServerMemory.destroy(webSocket);
+    webSocket = nullptr;
+    return nullptr;
+  }
+  strncpy(webSocketPath, path, MAX_PATH_LENGTH - 1);
+  webSocketPath[MAX_PATH_LENGTH - 1] = '\0';
+  return webSocket;
+}
+
+void WebServerBase::acceptWebSocket(MeteredClient& client, const String& method, const String& request) {
+  // The headers were read by handleClient() already; the WebSocket layer
+  // gets the request text to check the rest like on its own port
+  char value[64];
+  bool upgrade = findHeader(request, "Upgrade", value, sizeof(value)) && strcasecmp(value, "websocket") == 0;
+  if (upgrade && findHeader(request, "Connection", value, sizeof(value))) {
+    // e.g. "keep-alive, Upgrade" from Firefox
+    for (char* c = value; *c; c++) *c = tolower(*c);
+    upgrade = strstr(value, "upgrade") != nullptr;
+  } else {
+    upgrade = false;
+  }
+  if (method != "GET" || !upgrade) {
+    beginResponse(client, "text/plain", 426);
+    client.print("WebSocket endpoint");
+    return;
+  }
+
+  // Key, version, subprotocols and verifyClient are checked by the WebSocket
+  // server, with the same header parser
+  connectionKept = webSocket->accept(client, request.c_str());
+}
+
+DIYables_ESP32_WebSocket* WebServerBase::getWebSocket() {
   return webSocket;
 }
 
-void DIYables_ESP32_WebServer::handleWebSocket() {
+void WebServerBase::handleWebSocket() {
   if (webSocket != nullptr) {
     webSocket->loop();
   }
 }
 
 // Authentication methods
-void DIYables_ESP32_WebServer::enableAuthentication(const char* username, const char* password, const char* realm) {
+bool WebServerBase::enableAuthentication(const char* username, const char* password, const char* realm) {
+  // Fail closed: whatever happens below, protected routes stay protected
   authEnabled = true;
-  strncpy(authUsername, username, MAX_AUTH_USERNAME_LENGTH - 1);
-  authUsername[MAX_AUTH_USERNAME_LENGTH - 1] = '\0';
-  strncpy(authPassword, password, MAX_AUTH_PASSWORD_LENGTH - 1);
-  authPassword[MAX_AUTH_PASSWORD_LENGTH - 1] = '\0';
-  strncpy(authRealm, realm, MAX_AUTH_REALM_LENGTH - 1);
-  authRealm[MAX_AUTH_REALM_LENGTH - 1] = '\0';
+  clean(storage.authCredential, storage.maxAuthCredentialLength);
+  authCredentialLength = 0;
+  strncpy(storage.authRealm, realm, storage.maxAuthRealmLength - 1);
+  storage.authRealm[storage.maxAuthRealmLength - 1] = '\0';
+  
+  // Rejected rather than cut off: a shortened password would still log in.
+  // The only limit is the credential buffer of the config.
+  size_t usernameLength = strnlen(username, storage.maxAuthCredentialLength);
+  size_t passwordLength = strnlen(password, storage.maxAuthCredentialLength);
+  size_t plainLength = usernameLength + 1 + passwordLength;
+  if (plainLength >= storage.maxAuthCredentialLength ||
+      (size_t)base64_enc_len(plainLength) >= storage.maxAuthCredentialLength) {
+    Serial.println("ERROR: enableAuthentication: username or password too long, protected routes are locked");
+    return false;
+  }
+  
+  // Encode "username:password" once, requests are compared against the
+  // result. Encoded a few bytes at a time (a multiple of 3, so the parts join
+  // up), so any credential that fits the buffer works.
+  char plain[48];
+  size_t used = 0;
+  for (size_t i = 0; i < plainLength; i++) {
+    plain[used++] = i < usernameLength ? username[i]
+                  : i == usernameLength ? ':'
+                  : password[i - usernameLength - 1];
+    if (used == sizeof(plain) || i == plainLength - 1) {
+      authCredentialLength += base64_encode(storage.authCredential + authCredentialLength, plain, used);
+      used = 0;
+    }
+  }
+  storage.authCredential[authCredentialLength] = '\0';
+  clean(plain, sizeof(plain));
   
   Serial.println("Basic Authentication enabled");
   Serial.print("Realm: ");
-  Serial.println(authRealm);
+  Serial.println(storage.authRealm);
+  return true;
 }
 
-void DIYables_ESP32_WebServer::disableAuthentication() {
+void WebServerBase::disableAuthentication() {
   authEnabled = false;
+  clean(storage.authCredential, storage.maxAuthCredentialLength);
+  authCredentialLength = 0;
   Serial.println("Basic Authentication disabled");
 }
 
-bool DIYables_ESP32_WebServer::isAuthenticationEnabled() {
+bool WebServerBase::isAuthenticationEnabled() {
   return authEnabled;
 }
 
-void DIYables_ESP32_WebServer::send401(WiFiClient& client) {
+void WebServerBase::send401(WiFiClient& client) {
   client.println("HTTP/1.1 401 Unauthorized");
   client.print("WWW-Authenticate: Basic realm=\"");
-  client.print(authRealm);
+  client.print(storage.authRealm);
   client.println("\"");
   client.println("Content-Type: text/html");
+  printServerTiming(client);
   client.println("Connection: close");
   client.println();
   client.println("<!DOCTYPE html><html><head><title>401 Unauthorized</title></head>");
@@ -325,46 +958,369 @@ void DIYables_ESP32_WebServer::send401(WiFiClient& client) {
   client.println("</body></html>");
 }
 
-bool DIYables_ESP32_WebServer::checkAuthentication(const String& request) {
+void WebServerBase::setRouteAuth(const char* pattern, AuthPolicy policy, AuthVerifier verifier) {
+  int length = strnlen(pattern, MAX_PATH_LENGTH - 1);
+  bool prefix = length > 0 && pattern[length - 1] == '*';
+  if (prefix) length--;
+  
+  // Replace the rule for the same pattern, if any
+  AuthRule* rule = nullptr;
+  for (int i = 0; i < authRuleCount; i++) {
+    if (storage.authRules[i].prefix == prefix && storage.authRules[i].length == length &&
+        strncmp(storage.authRules[i].pattern, pattern, length) == 0) {
+      rule = &storage.authRules[i];
+      break;
+    }
+  }
+  if (rule == nullptr) {
+    if (authRuleCount >= storage.maxAuthRules) {
+      Serial.println("Max auth rules reached!");
+      return;
+    }
+    rule = &storage.authRules[authRuleCount++];
+  }
+  
+  memcpy(rule->pattern, pattern, length);
+  rule->pattern[length] = '\0';
+  rule->length = length;
+  rule->prefix = prefix;
+  rule->policy = policy;
+  rule->verifier = verifier;
+  if (policy == AUTH_CUSTOM && verifier == nullptr) {
+    Serial.println("AUTH_CUSTOM without a verifier: requests will be rejected");
+  }
+}
+
+void WebServerBase::clearRouteAuth() {
+  authRuleCount = 0;
+}
+
+const WebServerBase::AuthRule* WebServerBase::findAuthRule(const String& path) {
+  const AuthRule* best = nullptr;
+  const char* target = path.c_str();
+  unsigned int targetLength = path.length();
+  for (int i = 0; i < authRuleCount; i++) {
+    const AuthRule& rule = storage.authRules[i];
+    if (rule.prefix) {
+      if (targetLength < rule.length || strncmp(target, rule.pattern, rule.length) != 0) continue;
+      if (best == nullptr || rule.length > best->length) best = &rule;
+    } else if (targetLength == rule.length && strcmp(target, rule.pattern) == 0) {
+      return &rule;  // exact match wins
+    }
+  }
+  return best;
+}
+
+bool WebServerBase::checkAuthentication(const String& request) {
+  // Without a configured credential nothing may match (an empty one would
+  // accept an empty header), so AUTH_BASIC routes stay closed
+  if (!authEnabled || authCredentialLength == 0) {
+    return false;
+  }
+  
   // Look for Authorization header
   int authIndex = request.indexOf("Authorization: Basic ");
   if (authIndex == -1) {
     return false; // No auth header found
   }
   
-  // Extract the base64 encoded credentials
-  int start = authIndex + 21; // "Authorization: Basic " length
-  int end = request.indexOf('\r', start);
-  if (end == -1) {
-    end = request.indexOf('\n', start);
-  }
-  if (end == -1) {
+  // Locate the base64 encoded credentials in place, without copying them
+  const char* start = request.c_str() + authIndex + 21; // "Authorization: Basic " length
+  while (*start == ' ') start++;
+  const char* end = start;
+  while (*end != '\0' && *end != '\r' && *end != '\n') end++;
+  if (*end == '\0') {
     return false; // Malformed header
   }
+  while (end > start && end[-1] == ' ') end--;
   
-  String encodedCredentials = request.substring(start, end);
-  encodedCredentials.trim();
+  // Constant-time comparison, so the response time does not reveal how
+  // many leading characters were right (only the length can differ)
+  if ((size_t)(end - start) != authCredentialLength) {
+    return false;
+  }
+  return secure_compare(start, storage.authCredential, authCredentialLength);
+}
+
+// Admission control methods
+void WebServerBase::setMaxConnections(uint8_t maxConnections) {
+  this->maxConnections = maxConnections;
+}
+
+void WebServerBase::enableRateLimit(float requestsPerSecond, uint16_t burst) {
+  rateLimiter.configure(requestsPerSecond, burst);
   
-  // Create expected credentials string
-  String expectedCredentials = String(authUsername) + ":" + String(authPassword);
-  String expectedEncoded = base64Encode(expectedCredentials);
+  Serial.print("Rate limit enabled: ");
+  Serial.print(requestsPerSecond);
+  Serial.print(" req/s, burst ");
+  Serial.println(burst);
+}
+
+void WebServerBase::disableRateLimit() {
+  rateLimiter.disable();
+  Serial.println("Rate limit disabled");
+}
+
+// Metrics methods
+void WebServerBase::enableMetrics(const char* path) {
+  strncpy(metricsPath, path, MAX_PATH_LENGTH - 1);
+  metricsPath[MAX_PATH_LENGTH - 1] = '\0';
   
-  // Compare credentials
-  return encodedCredentials.equals(expectedEncoded);
+  Serial.print("Metrics endpoint enabled at ");
+  Serial.println(metricsPath);
+}
+
+void WebServerBase::disableMetrics() {
+  metricsPath[0] = '\0';
+}
+
+void WebServerBase::getServerMetrics(ServerMetricsSnapshot& snapshot) {
+  snapshot.uptimeMs = millis();
+  snapshot.connections = httpMetrics.connections.get();
+  snapshot.activeConnections = countConnections();
+  snapshot.rejectedBusy = httpMetrics.rejectedBusy.get();
+  snapshot.rejectedRate = httpMetrics.rejectedRate.get();
+  snapshot.authFailures = httpMetrics.authFailures.get();
+  snapshot.timeouts = httpMetrics.timeouts.get();
+  snapshot.bytesIn = httpMetrics.bytesIn.get();
+  snapshot.bytesOut = httpMetrics.bytesOut.get();
+
+  if (webSocket != nullptr) {
+    webSocket->getMetrics(snapshot.webSocket);
+  } else {
+    memset(&snapshot.webSocket, 0, sizeof(snapshot.webSocket));
+  }
+}
+
+uint16_t WebServerBase::getRouteMetricsCount() {
+  return routeCount + 1;
+}
+
+void WebServerBase::getRouteMetrics(uint16_t index, RouteMetricsSnapshot& route) {
+  // The entry after the last route counts requests no route matched
+  const RouteMetrics& metrics = (index < routeCount) ? storage.routes[index].metrics : notFoundMetrics;
+  route.path = (index < routeCount) ? storage.routes[index].path : "";
+  route.requests = metrics.requests.get();
+  route.errors = metrics.errors.get();
+  route.bytesIn = metrics.bytesIn.get();
+  route.bytesOut = metrics.bytesOut.get();
+  route.latency.copyFrom(metrics.latency);
+}
+
+void WebServerBase::writeMetrics(Print& out) {
+  ServerMetricsSnapshot snapshot;
+  getServerMetrics(snapshot);
+
+  writePrometheusHeader(out, "http_uptime_seconds", "gauge", "Time since the device booted.");
+  writePrometheusValue(out, "http_uptime_seconds", "", snapshot.uptimeMs / 1000);
+  writePrometheusHeader(out, "http_connections_total", "counter", "Admitted HTTP connections.");
+  writePrometheusValue(out, "http_connections_total", "", snapshot.connections);
+  writePrometheusHeader(out, "http_active_connections", "gauge", "Connections held open: event streams, parked responses, coroutines and WebSockets on the HTTP port.");
+  writePrometheusValue(out, "http_active_connections", "", snapshot.activeConnections);
+  writePrometheusHeader(out, "http_rejected_total", "counter", "Connections rejected by admission control.");
+  writePrometheusValue(out, "http_rejected_total", "reason=\"busy\"", snapshot.rejectedBusy);
+  writePrometheusValue(out, "http_rejected_total", "reason=\"rate\"", snapshot.rejectedRate);
+  writePrometheusHeader(out, "http_auth_failures_total", "counter", "Requests answered with 401.");
+  writePrometheusValue(out, "http_auth_failures_total", "", snapshot.authFailures);
+  writePrometheusHeader(out, "http_timeouts_total", "counter", "Requests not received completely in time.");
+  writePrometheusValue(out, "http_timeouts_total", "", snapshot.timeouts);
+  writePrometheusHeader(out, "http_bytes_total", "counter", "HTTP bytes by direction.");
+  writePrometheusValue(out, "http_bytes_total", "direction=\"in\"", snapshot.bytesIn);
+  writePrometheusValue(out, "http_bytes_total", "direction=\"out\"", snapshot.bytesOut);
+
+  // One route is copied at a time, whatever the size of the route table
+  RouteMetricsSnapshot route;
+  uint16_t routeMetricsCount = getRouteMetricsCount();
+  char routeLabel[2 * MAX_PATH_LENGTH];
+  char labels[2 * MAX_PATH_LENGTH + 32];
+  writePrometheusHeader(out, "http_requests_total", "counter", "HTTP requests by route.");
+  for (uint16_t i = 0; i < routeMetricsCount; i++) {
+    getRouteMetrics(i, route);
+    escapePrometheusLabel(routeLabel, sizeof(routeLabel), route.path);
+    snprintf(labels, sizeof(labels), "route=\"%s\"", routeLabel);
+    writePrometheusValue(out, "http_requests_total", labels, route.requests);
+  }
+  writePrometheusHeader(out, "http_errors_total", "counter", "Requests answered with 4xx by the server, by route.");
+  for (uint16_t i = 0; i < routeMetricsCount; i++) {
+    getRouteMetrics(i, route);
+    escapePrometheusLabel(routeLabel, sizeof(routeLabel), route.path);
+    snprintf(labels, sizeof(labels), "route=\"%s\"", routeLabel);
+    writePrometheusValue(out, "http_errors_total", labels, route.errors);
+  }
+  writePrometheusHeader(out, "http_route_bytes_total", "counter", "HTTP bytes by route and direction.");
+  for (uint16_t i = 0; i < routeMetricsCount; i++) {
+    getRouteMetrics(i, route);
+    escapePrometheusLabel(routeLabel, sizeof(routeLabel), route.path);
+    snprintf(labels, sizeof(labels), "route=\"%s\",direction=\"in\"", routeLabel);
+    writePrometheusValue(out, "http_route_bytes_total", labels, route.bytesIn);
+    snprintf(labels, sizeof(labels), "route=\"%s\",direction=\"out\"", routeLabel);
+    writePrometheusValue(out, "http_route_bytes_total", labels, route.bytesOut);
+  }
+  writePrometheusHeader(out, "http_request_duration_seconds", "histogram", "Time from accept to handler return, by route.");
+  for (uint16_t i = 0; i < routeMetricsCount; i++) {
+    getRouteMetrics(i, route);
+    escapePrometheusLabel(routeLabel, sizeof(routeLabel), route.path);
+    snprintf(labels, sizeof(labels), "route=\"%s\"", routeLabel);
+    writePrometheusHistogram(out, "http_request_duration_seconds", labels, route.latency);
+  }
+
+  writePrometheusWebSocket(out, snapshot.webSocket);
+  WebServerMemory.writePrometheus(out);
+}
+
+void WebServerBase::sendMetrics(WiFiClient& client) {
+  beginResponse(client, "text/plain; version=0.0.4");
+  writeMetrics(client);
 }
 
-String DIYables_ESP32_WebServer::base64Encode(const String& input) {
-  // Use the existing Base64 library
-  int inputLen = input.length();
-  int outputLen = ((inputLen + 2) / 3) * 4;
-  char* output = new char[outputLen + 1];
+// Tracing methods
+void WebServerBase::enableTracing(const char* path, bool serverTiming, uint16_t capacity) {
+  if (!WebServerTrace.begin(capacity)) {
+    Serial.println("Tracing: not enough memory for the trace buffer");
+    return;
+  }
+  strncpy(tracePath, path, MAX_PATH_LENGTH - 1);
+  tracePath[MAX_PATH_LENGTH - 1] = '\0';
+  serverTimingEnabled = serverTiming;
   
-  base64_encode(output, (char*)input.c_str(), inputLen);
-  output[outputLen] = '\0';
+  Serial.print("Tracing enabled at ");
+  Serial.println(tracePath);
+}
+
+void WebServerBase::disableTracing() {
+  WebServerTrace.end();
+  tracePath[0] = '\0';
+  serverTimingEnabled = false;
+}
+
+void WebServerBase::writeTrace(Print& out) {
+  WebServerTrace.writeChromeTrace(out);
+}
+
+void WebServerBase::tracePhase(TracePhase phase, uint32_t start) {
+  if (!WebServerTrace.isEnabled()) return;
+
+  uint32_t end = micros();
+  WebServerTrace.record(phase, requestId, start, end);
+  if (phase < TRACE_HTTP_HANDLER) {
+    phaseMicros[phase] = end - start;
+    tracedPhases |= (1 << phase);
+  }
+}
+
+void WebServerBase::printServerTiming(WiFiClient& client) {
+  if (!serverTimingEnabled || tracedPhases == 0) return;
+
+  // e.g. "Server-Timing: accept;dur=0.021, headers;dur=1.204, auth;dur=0.087"
+  char header[160];
+  int length = snprintf(header, sizeof(header), "Server-Timing: ");
+  for (int phase = 0; phase < TRACE_HTTP_HANDLER; phase++) {
+    if (!(tracedPhases & (1 << phase))) continue;
+    length += snprintf(header + length, sizeof(header) - length, "%s%s;dur=%lu.%03lu",
+                       length > 15 ? ", " : "", DIYables_ESP32_Trace::phaseName(phase),
+                       (unsigned long)(phaseMicros[phase] / 1000), (unsigned long)(phaseMicros[phase] % 1000));
+  }
+  client.println(header);
+  tracedPhases = 0; // only the first response header block of a request
+}
+
+void WebServerBase::sendTrace(WiFiClient& client) {
+  beginResponse(client, "application/json");
+  writeTrace(client);
+}
+
+// Compression methods
+bool WebServerBase::enableCompression(uint32_t minLength) {
+  if (!deflateEncoder.allocate()) {
+    Serial.println("Compression: not enough memory for the encoder");
+    return false;
+  }
+  compressionEnabled = true;
+  compressionMinLength = minLength;
   
-  String result = String(output);
-  delete[] output;
-  return result;
+  Serial.print("Compression enabled for bodies from ");
+  Serial.print(minLength);
+  Serial.println(" bytes");
+  return true;
+}
+
+void WebServerBase::disableCompression() {
+  compressionEnabled = false;
+  deflateEncoder.release();
+}
+
+void WebServerBase::setCompressionThreshold(const char* path, uint32_t minLength) {
+  Route* route = findRoute(String(path));
+  if (route != nullptr) {
+    route->compressionMinLength = minLength;
+    return;
+  }
+  Serial.print("setCompressionThreshold: no route ");
+  Serial.println(path);
+}
+
+// True if an Accept-Encoding value lists `coding` without "q=0"
+static bool acceptsCoding(const char* value, const char* valueEnd, const char* coding) {
+  size_t codingLength = strlen(coding);
+  const char* item = value;
+  while (item < valueEnd) {
+    const char* itemEnd = item;
+    while (itemEnd < valueEnd && *itemEnd != ',') itemEnd++;
+    const char* name = item;
+    while (name < itemEnd && *name == ' ') name++;
+    const char* nameEnd = name;
+    while (nameEnd < itemEnd && *nameEnd != ';' && *nameEnd != ' ') nameEnd++;
+    
+    if ((size_t)(nameEnd - name) == codingLength && strncasecmp(name, coding, codingLength) == 0) {
+      for (const char* q = nameEnd; q + 2 < itemEnd; q++) {
+        if ((q[0] == 'q' || q[0] == 'Q') && q[1] == '=') {
+          // "q=0", "q=0.0", "q=0.000" mean "not acceptable"
+          const char* digit = q + 2;
+          while (digit < itemEnd && (*digit == '0' || *digit == '.')) digit++;
+          return digit < itemEnd && *digit >= '1' && *digit <= '9';
+        }
+      }
+      return true;
+    }
+    item = itemEnd + 1;
+  }
+  return false;
+}
+
+void WebServerBase::prepareCompression(MeteredClient& client, Route* route, const String& request) {
+  responseClient = &client;
+  responseMinLength = COMPRESSION_OFF;
+  if (!compressionEnabled) return;
+  
+  uint32_t minLength = (route && route->compressionMinLength != ROUTE_COMPRESSION_DEFAULT) ? route->compressionMinLength : compressionMinLength;
+  if (minLength == COMPRESSION_OFF) return;
+  
+  // Chunked transfer encoding needs HTTP/1.1
+  int lineEnd = request.indexOf('\r');
+  if (lineEnd == -1 || !request.substring(0, lineEnd).endsWith("HTTP/1.1")) return;
+  
+  char value[128];
+  if (!findHeader(request, "Accept-Encoding", value, sizeof(value))) return;
+  const char* valueEnd = value + strlen(value);
+  
+  // gzip first: older clients got "deflate" (zlib) wrong
+  if (acceptsCoding(value, valueEnd, "gzip")) {
+    responseFormat = DEFLATE_GZIP;
+  } else if (acceptsCoding(value, valueEnd, "deflate")) {
+    responseFormat = DEFLATE_ZLIB;
+  } else {
+    return;
+  }
+  responseMinLength = minLength;
+}
+
+void WebServerBase::endCompression() {
+  if (compressedResponse.isActive()) {
+    compressedResponse.end();
+    responseClient->setFilter(nullptr);
+  }
+  responseClient = nullptr;
+  responseMinLength = COMPRESSION_OFF;
 }
 
 // WebSocket functionality temporarily disabled
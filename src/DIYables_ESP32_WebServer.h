@@ -3,19 +3,49 @@
 
 #include <WiFi.h>
 #include "base64/Base64.h"
+#include "DIYables_ESP32_RateLimiter.h"
+#include "DIYables_ESP32_Metrics.h"
+#include "DIYables_ESP32_Trace.h"
+#include "DIYables_ESP32_Memory.h"
+#include "DIYables_ESP32_Json.h"
+#include "DIYables_ESP32_Deflate.h"
+#include "DIYables_ESP32_EventSource.h"
+#include "DIYables_ESP32_Poll.h"
 
 // Forward declare WebSocket class
 class DIYables_ESP32_WebSocket;
 
+// Default capacities of DIYables_ESP32_WebServer (see WebServerConfig)
 #define MAX_ROUTES 10
+#define MAX_AUTH_RULES 8
+#define MAX_EVENT_SOURCES 2
+#define MAX_DEFERRED_RESPONSES 4
+#define MAX_AUTH_REALM_LENGTH 64
+#define MAX_AUTH_CREDENTIAL_LENGTH 88 // base64("username:password") + '\0'
+
+// Shared by every server instance (part of the handler interface); can be
+// changed with build flags
+#ifndef MAX_PATH_LENGTH
 #define MAX_PATH_LENGTH 32
-#define MAX_HTML_SIZE 1024
+#endif
+#ifndef MAX_QUERY_PARAMS
 #define MAX_QUERY_PARAMS 5
+#endif
+#ifndef MAX_PARAM_KEY_LENGTH
 #define MAX_PARAM_KEY_LENGTH 16
+#endif
+#ifndef MAX_PARAM_VALUE_LENGTH
 #define MAX_PARAM_VALUE_LENGTH 16
-#define MAX_AUTH_USERNAME_LENGTH 32
-#define MAX_AUTH_PASSWORD_LENGTH 32
-#define MAX_AUTH_REALM_LENGTH 64
+#endif
+
+#define DEFAULT_MAX_BODY_LENGTH 8192 // Larger request bodies get 413 before they are read
+#define BODY_CHUNK_SIZE 128 // Bytes read from the socket at a time while receiving a body
+#define COMPRESSION_DEFAULT_MIN_LENGTH 256 // Smaller response bodies are not compressed
+#define COMPRESSION_OFF 0xFFFFFFFF // setCompressionThreshold() value that never compresses a route
+#define DEFERRED_DEFAULT_TIMEOUT 30000 // ms a parked request waits before the server answers it
+#define DEFERRED_POST_INTERVAL 20 // ms between looks for responses posted by other tasks while requests are parked
+#define RATE_LIMIT_AUTH_PENALTY 2 // Extra tokens taken from a client after a failed login
+#define REJECTION_DRAIN_LENGTH 2048 // Bytes of a request answered with 429/503 that are dropped before closing
 
 // Structure to hold query parameters
 struct QueryParams {
@@ -27,55 +57,364 @@ struct QueryParams {
   int count;
 };
 
+// Capacities of a server instance. The defaults are those of
+// DIYables_ESP32_WebServer; derive from it to change some of them:
+//
+//   struct GatewayConfig : WebServerConfig {
+//     static const uint16_t maxRoutes = 32;
+//     static const uint16_t maxDeferredResponses = 8;
+//   };
+//   BasicWebServer<GatewayConfig> server;
+struct WebServerConfig {
+  static const uint16_t maxRoutes = MAX_ROUTES;
+  static const uint16_t maxAuthRules = MAX_AUTH_RULES;
+  static const uint16_t maxEventSources = MAX_EVENT_SOURCES;
+  static const uint16_t maxDeferredResponses = MAX_DEFERRED_RESPONSES;
+  static const uint16_t maxAuthRealmLength = MAX_AUTH_REALM_LENGTH;
+  static const uint16_t maxAuthCredentialLength = MAX_AUTH_CREDENTIAL_LENGTH;  // limits username + password
+};
+
+// Metrics of one route (see BasicMetricsSnapshot)
+struct RouteMetricsSnapshot {
+  const char* path;  // "" for requests no route matched
+  uint32_t requests;
+  uint32_t errors;
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+  HistogramSnapshot latency;
+};
+
+// Server-wide part of a metrics snapshot
+struct ServerMetricsSnapshot {
+  unsigned long uptimeMs;
+  uint32_t connections;
+  uint32_t activeConnections;  // held open: event streams, parked responses, coroutines, WebSockets on this port
+  uint32_t rejectedBusy;
+  uint32_t rejectedRate;
+  uint32_t authFailures;
+  uint32_t timeouts;
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+  WebSocketMetricsSnapshot webSocket;
+};
+
+// Plain copy of all server metrics (see getMetricsSnapshot)
+template <uint16_t MaxRoutes>
+struct BasicMetricsSnapshot : ServerMetricsSnapshot {
+  typedef RouteMetricsSnapshot Route;
+  int routeCount;  // entries used in routes[], the last one is "not found"
+  Route routes[MaxRoutes + 1];
+};
+typedef BasicMetricsSnapshot<MAX_ROUTES> MetricsSnapshot;
+
 // Handler function type
 typedef void (*RouteHandler)(WiFiClient& client, const String& method, const String& request, const QueryParams& params, const String& jsonData);
 
-class DIYables_ESP32_WebServer {
+// Body handler: receives the request body in chunks as it arrives, instead of
+// the whole body as jsonData (offset + length == total on the last chunk)
+typedef void (*BodyHandler)(const String& path, const uint8_t* data, size_t length, size_t offset, size_t total);
+
+// Handle of a request parked with deferResponse(). It stays safe to use after
+// the request was completed, timed out or the client went away: the server
+// then ignores it.
+struct DeferredResponse {
+  uint16_t slot;
+  uint16_t generation;  // 0 for "no request"
+  bool isValid() const { return generation != 0; }
+};
+
+// Coroutine handlers: Task handler(Request&, Response&), see addRoute()
+#include "DIYables_ESP32_Coroutine.h"
+
+// Authentication policy of a route or route prefix
+enum AuthPolicy {
+  AUTH_PUBLIC,  // no authentication, the Authorization header is not even looked at
+  AUTH_BASIC,   // credentials set with enableAuthentication()
+  AUTH_CUSTOM   // user supplied AuthVerifier
+};
+
+// Custom verifier: return true to let the request through (request holds the request line and headers)
+typedef bool (*AuthVerifier)(const String& path, const String& request);
+
+// Server logic shared by every BasicWebServer<Config>; the tables it works
+// on are owned by the derived class and sized by its Config
+class WebServerBase {
 public:
-  DIYables_ESP32_WebServer(int port = 80);
+  WebServerBase(const WebServerBase&) = delete;
+  WebServerBase& operator=(const WebServerBase&) = delete;
+  
   void begin();  // Start server assuming WiFi is already connected
   void begin(const char* ssid, const char* pass);  // Connect to WiFi and start server
   void addRoute(const char* path, RouteHandler handler);
+#if WEBSERVER_COROUTINES
+  // The handler may co_await request.read(), response.writable() or sleepFor()
+  // without blocking other clients; it reads the request body itself
+  void addRoute(const char* path, CoroutineHandler handler);
+#endif
   void setNotFoundHandler(RouteHandler handler);
+  void setMaxBodyLength(const char* path, uint32_t maxLength);  // for a route added with addRoute
+  void setBodyHandler(const char* path, BodyHandler handler);    // stream the body of a route instead of buffering it
   void handleClient();
+  // Sleeps until a socket of the server (HTTP, event streams, WebSocket) is
+  // ready or a timer of it expires, at most timeoutMs, then serves what is
+  // ready; replaces handleClient() + handleWebSocket() in loop(). Returns
+  // false if nothing happened.
+  bool poll(unsigned long timeoutMs = POLL_DEFAULT_TIMEOUT);
   void sendResponse(WiFiClient& client, const char* content, const char* contentType = "text/html");
+  void beginResponse(WiFiClient& client, const char* contentType = "text/html", int statusCode = 200);  // headers only, the handler writes the body (e.g. with JsonStreamWriter)
   void send404(WiFiClient& client);
   void printWifiStatus();
+  static void parseQueryString(const String& path, QueryParams& params);  // "/page?a=1&b=2" -> params
+  static bool findHeader(const String& request, const char* name, char* value, size_t size);  // name matched case-insensitively
   
   // Basic Authentication methods (disabled by default for backward compatibility)
-  void enableAuthentication(const char* username, const char* password, const char* realm = "ESP32 Server");
+  // Returns false if "username:password" does not fit the credential buffer
+  // (maxAuthCredentialLength of the config, encoded); authentication is then
+  // enabled without any valid credential, so protected routes answer 401
+  // until this succeeds
+  bool enableAuthentication(const char* username, const char* password, const char* realm = "ESP32 Server");
   void disableAuthentication();
   bool isAuthenticationEnabled();
   void send401(WiFiClient& client);
   
+  // Per-route authentication policy. A pattern ending in '*' matches every path
+  // with that prefix ("/static/*"); exact patterns win over prefixes and longer
+  // prefixes over shorter ones. Paths without a rule use the global setting.
+  void setRouteAuth(const char* pattern, AuthPolicy policy, AuthVerifier verifier = nullptr);
+  void clearRouteAuth();
+  
+  // Admission control (disabled by default), applied before any header is read
+  void setMaxConnections(uint8_t maxConnections);  // held-open connections, 0 = unlimited
+  void enableRateLimit(float requestsPerSecond, uint16_t burst);  // per client IP
+  void disableRateLimit();
+  
+  // Metrics (always collected; the Prometheus text endpoint is opt-in)
+  void enableMetrics(const char* path = "/metrics");
+  void disableMetrics();
+  void getServerMetrics(ServerMetricsSnapshot& snapshot);
+  uint16_t getRouteMetricsCount();  // routes plus the "not found" entry
+  void getRouteMetrics(uint16_t index, RouteMetricsSnapshot& route);
+  void writeMetrics(Print& out);
+  
+  // Per-phase tracing (disabled by default), dumped as Chrome trace-event JSON.
+  // With serverTiming set, responses sent through sendResponse/send404/send401
+  // also carry a Server-Timing header with the phases completed so far.
+  void enableTracing(const char* path = "/trace", bool serverTiming = false, uint16_t capacity = TRACE_DEFAULT_CAPACITY);
+  void disableTracing();
+  void writeTrace(Print& out);
+  
+  // Response compression (disabled by default): bodies written after
+  // beginResponse()/sendResponse() are sent gzip or deflate compressed and
+  // chunked when the client's Accept-Encoding allows it and they reach the
+  // route's threshold. Uses about 5 KB of RAM while enabled.
+  bool enableCompression(uint32_t minLength = COMPRESSION_DEFAULT_MIN_LENGTH);
+  void disableCompression();
+  void setCompressionThreshold(const char* path, uint32_t minLength);  // per route, COMPRESSION_OFF to never compress
+  
+  // Deferred responses: a handler can park its request and return; the
+  // connection stays open and is answered later from loop() (e.g. when a
+  // sensor conversion finished, or for long polling). Call these from the
+  // task that runs handleClient(), except isPending() and postResponse().
+  DeferredResponse deferResponse(WiFiClient& client, unsigned long timeoutMs = DEFERRED_DEFAULT_TIMEOUT, int timeoutStatus = 504);
+  bool isPending(DeferredResponse response);
+  bool completeResponse(DeferredResponse response, const char* content, const char* contentType = "text/html", int statusCode = 200);
+  // From any task: the response is sent by the next handleClient()/poll().
+  // content and contentType are not copied, so keep them valid until
+  // isPending() returns false. False if the request is gone or already has a
+  // posted response.
+  bool postResponse(DeferredResponse response, const char* content, const char* contentType = "text/html", int statusCode = 200);
+  WiFiClient* resumeResponse(DeferredResponse response);  // write the response yourself, then call finishResponse()
+  void finishResponse(DeferredResponse response);
+  uint16_t pendingResponses();
+  
+  // Server-Sent Events: requests for the source's path are handed over to it
+  // (after the authentication policy of that path is applied) and stay open
+  void addEventSource(DIYables_ESP32_EventSource& source);
+  
   // WebSocket functionality
   DIYables_ESP32_WebSocket* enableWebSocket(uint16_t wsPort = 81);
+  // WebSocket on the HTTP port: upgrade requests for path are handed over
+  // (after the authentication policy of that path is applied)
+  DIYables_ESP32_WebSocket* enableWebSocket(const char* path);
   DIYables_ESP32_WebSocket* getWebSocket();
   void handleWebSocket();
 
-private:
-  WiFiServer server;
-  DIYables_ESP32_WebSocket* webSocket;
+protected:
   struct Route {
     char path[MAX_PATH_LENGTH];
     RouteHandler handler;
+    uint32_t maxBodyLength;
+    BodyHandler bodyHandler;
+#if WEBSERVER_COROUTINES
+    CoroutineHandler coroutine;
+#endif
+    uint32_t compressionMinLength;  // ROUTE_COMPRESSION_DEFAULT: the server-wide threshold
+    RouteMetrics metrics;
+  };
+  struct AuthRule {
+    char pattern[MAX_PATH_LENGTH];  // without the trailing '*'
+    uint8_t length;
+    bool prefix;
+    AuthPolicy policy;
+    AuthVerifier verifier;
+  };
+  enum DeferredPostState : uint8_t {
+    DEFERRED_POST_NONE,
+    DEFERRED_POST_WRITING,  // claimed by postResponse(), fields not complete yet
+    DEFERRED_POST_READY
+  };
+  struct DeferredSlot {
+    WiFiClient client;
+    unsigned long start;
+    unsigned long timeout;
+    int timeoutStatus;
+    std::atomic<uint16_t> generation;  // 0: free; read by postResponse() on other tasks
+    // Response handed over by postResponse(), for the request of postGeneration
+    std::atomic<uint8_t> postState;
+    uint16_t postGeneration;
+    const char* postContent;
+    const char* postContentType;
+    int postStatus;
+  };
+  
+  // Tables of the derived class, with their capacities
+  struct Storage {
+    Route* routes;
+    uint16_t maxRoutes;
+    AuthRule* authRules;
+    uint16_t maxAuthRules;
+    DIYables_ESP32_EventSource** eventSources;
+    uint16_t maxEventSources;
+    DeferredSlot* deferredSlots;
+    uint16_t maxDeferredResponses;
+    char* authRealm;
+    uint16_t maxAuthRealmLength;
+    char* authCredential;  // expected Authorization value, encoded once
+    uint16_t maxAuthCredentialLength;
   };
-  Route routes[MAX_ROUTES];
+  
+  WebServerBase(int port, const Storage& storage);  // only stores the pointers
+  void initStorage();  // called by the derived constructor once the tables exist
+  
+private:
+  WiFiServer server;
+  DIYables_ESP32_WebSocket* webSocket;
+  char webSocketPath[MAX_PATH_LENGTH];  // "" when WebSocket has its own port
+  Storage storage;
   int routeCount;
   RouteHandler notFoundHandler;
   
   // Authentication variables
   bool authEnabled;
-  char authUsername[MAX_AUTH_USERNAME_LENGTH];
-  char authPassword[MAX_AUTH_PASSWORD_LENGTH];
-  char authRealm[MAX_AUTH_REALM_LENGTH];
+  uint16_t authCredentialLength;
+  int authRuleCount;
+  
+  // Admission control variables
+  uint8_t maxConnections;
+  DIYables_ESP32_RateLimiter rateLimiter;
+  
+  // Metrics variables
+  HttpMetrics httpMetrics;
+  RouteMetrics notFoundMetrics;
+  char metricsPath[MAX_PATH_LENGTH];
   
-  void parseQueryString(const String& path, QueryParams& params);
-  void processRequest(WiFiClient& client, const String& method, const String& path, const QueryParams& params, const String& jsonData, const String& request);
+  // Tracing variables
+  char tracePath[MAX_PATH_LENGTH];
+  bool serverTimingEnabled;
+  uint16_t requestId;
+  uint8_t tracedPhases;                   // bit mask of phases recorded for the current request
+  uint32_t phaseMicros[TRACE_HTTP_HANDLER]; // accept, headers, body, auth
+  
+  uint32_t bodyBytesRead;  // body bytes of the current request (not part of the request string)
+  
+  // Server-Sent Events variables
+  int eventSourceCount;
+  bool connectionKept;  // the connection was handed over and must not be closed
+  
+  // Deferred response variables
+  uint16_t deferredGeneration;
+  unsigned long deferredCheck;
+  
+#if WEBSERVER_COROUTINES
+  CoroutineScheduler coroutines;
+#endif
+  
+  // Compression variables
+  DeflateEncoder deflateEncoder;
+  CompressedResponse compressedResponse;
+  bool compressionEnabled;
+  uint32_t compressionMinLength;
+  MeteredClient* responseClient;  // client of the handler being run, nullptr outside handlers
+  DeflateFormat responseFormat;
+  uint32_t responseMinLength;     // COMPRESSION_OFF: do not compress this response
+  
+  Route* addRouteEntry(const char* path);
+  bool admitClient(WiFiClient& client);
+  uint8_t countConnections();
+  void sendRejection(WiFiClient& client, int statusCode, uint32_t retryAfter);
+  Route* findRoute(const String& path);
+  DIYables_ESP32_EventSource* findEventSource(const String& path);
+  bool screenRequest(MeteredClient& client, const String& path, const String& request, int contentLength, unsigned long requestStart, Route*& route);  // contentLength -1: invalid
+  void processRequest(MeteredClient& client, Route* route, const String& method, const String& path, const QueryParams& params, const String& jsonData, const String& request, unsigned long requestStart);
+#if WEBSERVER_COROUTINES
+  void startCoroutine(MeteredClient& client, Route* route, const String& method, const String& path, const QueryParams& params, const String& request, int contentLength, unsigned long requestStart);
+#endif
+  void finishRequest(MeteredClient& client, RouteMetrics& metrics, const String& request, unsigned long requestStart, uint32_t bytesBefore, uint32_t handlerStart);
+  bool readBody(WiFiClient& client, Route* route, const String& path, int contentLength, String& bodyData, unsigned long deadline);
+  void discardInput(WiFiClient& client, int maxLength);
+  DeferredSlot* findDeferred(DeferredResponse response);
+  void servicePosted(DeferredSlot& slot, uint16_t index);
+  void serviceDeferred();
+  void watchDeferred(SocketPoller& poller);
+  void prepareCompression(MeteredClient& client, Route* route, const String& request);
+  void endCompression();
+  void acceptWebSocket(MeteredClient& client, const String& method, const String& request);
+  void send400(WiFiClient& client);
+  void send413(WiFiClient& client);
+  void sendMetrics(WiFiClient& client);
+  void tracePhase(TracePhase phase, uint32_t start);
+  void printServerTiming(WiFiClient& client);
+  void sendTrace(WiFiClient& client);
+  const AuthRule* findAuthRule(const String& path);
   bool checkAuthentication(const String& request);
-  String base64Encode(const String& input);
 };
 
+// Web server whose tables are sized at compile time by Config (see
+// WebServerConfig); instances with different configs share all the code.
+template <class Config = WebServerConfig>
+class BasicWebServer : public WebServerBase {
+public:
+  typedef BasicMetricsSnapshot<Config::maxRoutes> MetricsSnapshot;
+  
+  BasicWebServer(int port = 80) : WebServerBase(port, {
+    routeTable, Config::maxRoutes,
+    authRuleTable, Config::maxAuthRules,
+    eventSourceTable, Config::maxEventSources,
+    deferredTable, Config::maxDeferredResponses,
+    authRealmBuffer, Config::maxAuthRealmLength,
+    authCredentialBuffer, Config::maxAuthCredentialLength}) {
+    initStorage();
+  }
+  
+  void getMetricsSnapshot(MetricsSnapshot& snapshot) {
+    getServerMetrics(snapshot);
+    snapshot.routeCount = getRouteMetricsCount();
+    for (uint16_t i = 0; i < snapshot.routeCount; i++) {
+      getRouteMetrics(i, snapshot.routes[i]);
+    }
+  }
+  
+private:
+  Route routeTable[Config::maxRoutes];
+  AuthRule authRuleTable[Config::maxAuthRules];
+  DIYables_ESP32_EventSource* eventSourceTable[Config::maxEventSources];
+  DeferredSlot deferredTable[Config::maxDeferredResponses];
+  char authRealmBuffer[Config::maxAuthRealmLength];
+  char authCredentialBuffer[Config::maxAuthCredentialLength];
+};
+
+typedef BasicWebServer<> DIYables_ESP32_WebServer;
+
 // Include WebSocket functionality (automatically available but only compiled if used)
 #include "DIYables_ESP32_WebSocket.h"
 
@@ -4,14 +4,14 @@
 DIYables_ESP32_WebSocket* DIYables_ESP32_WebSocket::instance = nullptr;
 
 DIYables_ESP32_WebSocket::DIYables_ESP32_WebSocket(uint16_t port) 
-  : port(port), openHandler(nullptr), messageHandler(nullptr), closeHandler(nullptr), initialized(false), clientCount(0), lastWiFiCheck(0), wifiWasConnected(false) {
-  wsServer = new net::WebSocketServer(port);
+  : port(port), openHandler(nullptr), messageHandler(nullptr), closeHandler(nullptr), chunkHandler(nullptr), verifyHandler(nullptr), initialized(false), clientCount(0), lastWiFiCheck(0), wifiWasConnected(false) {
+  wsServer = WebServerMemory.create<net::WebSocketServer>(MEMORY_WEBSOCKET, port);
   instance = this; // Set static instance for callbacks
 }
 
 DIYables_ESP32_WebSocket::~DIYables_ESP32_WebSocket() {
   if (wsServer) {
-    delete wsServer;
+    WebServerMemory.destroy(wsServer);
     wsServer = nullptr;
   }
   if (instance == this) {
@@ -28,6 +28,9 @@ void DIYables_ESP32_WebSocket::staticOnConnection(net::WebSocket &ws) {
     // Set up individual client handlers
     ws.onMessage(staticOnMessage);
     ws.onClose(staticOnClose);
+    if (instance->chunkHandler) {
+      ws.onMessageChunk(staticOnMessageChunk);
+    }
     
     if (instance->openHandler) {
       instance->openHandler(ws);
@@ -41,6 +44,12 @@ void DIYables_ESP32_WebSocket::staticOnMessage(net::WebSocket &ws, const net::We
   }
 }
 
+void DIYables_ESP32_WebSocket::staticOnMessageChunk(net::WebSocket &ws, const net::WebSocket::DataType dataType, const char *data, uint16_t length, bool isFirst, bool isFinal) {
+  if (instance && instance->chunkHandler) {
+    instance->chunkHandler(ws, dataType, data, length, isFirst, isFinal);
+  }
+}
+
 void DIYables_ESP32_WebSocket::staticOnClose(net::WebSocket &ws, const net::WebSocket::CloseCode code, const char *reason, uint16_t length) {
   if (instance) {
     Serial.print("WebSocket client disconnected - Code: ");
@@ -71,7 +80,7 @@ bool DIYables_ESP32_WebSocket::begin() {
   wsServer->onConnection(staticOnConnection);
   
   // Start the WebSocket server
-  wsServer->begin();
+  wsServer->begin(verifyHandler);
   initialized = true;
   wifiWasConnected = true;
   lastWiFiCheck = millis();
@@ -111,6 +120,24 @@ void DIYables_ESP32_WebSocket::loop() {
   }
 }
 
+void DIYables_ESP32_WebSocket::watch(SocketPoller& poller) {
+  if (!initialized || !wsServer) return;
+  // Wake up for the periodic WiFi check as well
+  unsigned long sinceCheck = millis() - lastWiFiCheck;
+  poller.wakeAfter(sinceCheck > 2000 ? 0 : 2001 - sinceCheck, POLL_WEBSOCKET);
+  if (WiFi.status() == WL_CONNECTED) {
+    wsServer->watch(poller, POLL_WEBSOCKET);
+  }
+}
+
+bool DIYables_ESP32_WebSocket::accept(WiFiClient& client, const char* headers) {
+  if (!initialized || !wsServer) {
+    client.print("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    return false;
+  }
+  return wsServer->accept(client, headers) != nullptr;
+}
+
 void DIYables_ESP32_WebSocket::onOpen(WebSocketOpenHandler handler) {
   openHandler = handler;
 }
@@ -123,6 +150,17 @@ void DIYables_ESP32_WebSocket::onClose(WebSocketCloseHandler handler) {
   closeHandler = handler;
 }
 
+void DIYables_ESP32_WebSocket::onMessageChunk(WebSocketChunkHandler handler) {
+  chunkHandler = handler;
+}
+
+void DIYables_ESP32_WebSocket::onVerify(WebSocketVerifyHandler handler) {
+  verifyHandler = handler;
+  if (wsServer) {
+    wsServer->onVerifyClient(handler);
+  }
+}
+
 void DIYables_ESP32_WebSocket::broadcastTXT(const char* payload) {
   if (wsServer && initialized) {
     wsServer->broadcast(net::WebSocket::DataType::TEXT, payload, strlen(payload));
@@ -152,6 +190,14 @@ bool DIYables_ESP32_WebSocket::isListening() {
   return initialized && wsServer;
 }
 
+void DIYables_ESP32_WebSocket::getMetrics(WebSocketMetricsSnapshot& snapshot) {
+  if (wsServer) {
+    snapshot.copyFrom(wsServer->getMetrics());
+  } else {
+    memset(&snapshot, 0, sizeof(snapshot));
+  }
+}
+
 void DIYables_ESP32_WebSocket::checkWiFiConnection() {
   // Check WiFi status every 2 seconds
   if (millis() - lastWiFiCheck > 2000) {
@@ -167,8 +213,8 @@ void DIYables_ESP32_WebSocket::checkWiFiConnection() {
       // Stop the WebSocket server
       if (wsServer && initialized) {
         initialized = false;
-        delete wsServer;
-        wsServer = new net::WebSocketServer(port);
+        WebServerMemory.destroy(wsServer);
+        wsServer = WebServerMemory.create<net::WebSocketServer>(MEMORY_WEBSOCKET, port);
       }
     }
     // WiFi reconnected - restart WebSocket
@@ -190,14 +236,14 @@ void DIYables_ESP32_WebSocket::restartWebSocket() {
   // Stop existing server if running
   if (wsServer && initialized) {
     initialized = false;
-    delete wsServer;
-    wsServer = new net::WebSocketServer(port);
+    WebServerMemory.destroy(wsServer);
+    wsServer = WebServerMemory.create<net::WebSocketServer>(MEMORY_WEBSOCKET, port);
   }
   
   // Restart the server
   if (wsServer) {
     wsServer->onConnection(staticOnConnection);
-    wsServer->begin();
+    wsServer->begin(verifyHandler);
     initialized = true;
   }
 }
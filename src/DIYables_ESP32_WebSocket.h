@@ -8,10 +8,14 @@
 typedef void (*WebSocketEventHandler)(net::WebSocket& ws, const net::WebSocket::DataType dataType, const char* message, uint16_t length);
 typedef void (*WebSocketOpenHandler)(net::WebSocket& ws);
 typedef void (*WebSocketCloseHandler)(net::WebSocket& ws, const net::WebSocket::CloseCode code, const char* reason, uint16_t length);
+// Receives data messages in pieces as they arrive (no size limit), see onMessageChunk()
+typedef void (*WebSocketChunkHandler)(net::WebSocket& ws, const net::WebSocket::DataType dataType, const char* data, uint16_t length, bool isFirst, bool isFinal);
+// Checks a handshake header (other than those of the protocol), false refuses the client
+typedef bool (*WebSocketVerifyHandler)(const IPAddress& ip, const char* header, const char* value);
 
 class DIYables_ESP32_WebSocket {
 public:
-  DIYables_ESP32_WebSocket(uint16_t port = 81);
+  DIYables_ESP32_WebSocket(uint16_t port = 81);  // 0: no port of its own, connections come from the web server
   ~DIYables_ESP32_WebSocket();
   
   // Initialize the WebSocket server
@@ -19,11 +23,22 @@ public:
   
   // Handle WebSocket connections and messages
   void loop();
+  void watch(SocketPoller& poller);  // what loop() waits for, see DIYables_ESP32_WebServer::poll()
+  
+  // Takes over an upgrade request the web server has read (Upgrade and
+  // Connection checked); the other headers are checked like on the own port
+  bool accept(WiFiClient& client, const char* headers);
   
   // Set event handlers
   void onOpen(WebSocketOpenHandler handler);
   void onMessage(WebSocketEventHandler handler);
   void onClose(WebSocketCloseHandler handler);
+  // Replaces onMessage() for clients connecting afterwards: messages of any
+  // length (e.g. firmware or config uploads) are passed on in chunks of up to
+  // kBufferMaxSize bytes. Text is not checked for valid UTF-8.
+  void onMessageChunk(WebSocketChunkHandler handler);
+  // Checks the headers of every upgrade request, on the own port and on the web server's
+  void onVerify(WebSocketVerifyHandler handler);
   
   // Send text message to all connected clients
   void broadcastTXT(const char* payload);
@@ -38,6 +53,9 @@ public:
   // Check if server is listening
   bool isListening();
   
+  // Copy the WebSocket server metrics
+  void getMetrics(WebSocketMetricsSnapshot& snapshot);
+  
   // WiFi connection management
   void checkWiFiConnection();
   void restartWebSocket();
@@ -48,6 +66,8 @@ private:
   WebSocketOpenHandler openHandler;
   WebSocketEventHandler messageHandler;
   WebSocketCloseHandler closeHandler;
+  WebSocketChunkHandler chunkHandler;
+  WebSocketVerifyHandler verifyHandler;
   bool initialized;
   uint8_t clientCount;
   
@@ -62,6 +82,7 @@ private:
   static void staticOnConnection(net::WebSocket &ws);
   static void staticOnMessage(net::WebSocket &ws, const net::WebSocket::DataType dataType, const char *message, uint16_t length);
   static void staticOnClose(net::WebSocket &ws, const net::WebSocket::CloseCode code, const char *reason, uint16_t length);
+  static void staticOnMessageChunk(net::WebSocket &ws, const net::WebSocket::DataType dataType, const char *data, uint16_t length, bool isFirst, bool isFinal);
 };
 
 #endif
@@ -24,6 +24,9 @@ namespace net {
 // Helper functions:
 //
 
+/** Largest control frame payload allowed by RFC 6455 (5.5). */
+constexpr uint8_t kMaxControlPayloadLength{125};
+
 constexpr bool isControlFrame(uint8_t opcode) {
   return ((opcode == WebSocket::Opcode::PING_FRAME) ||
           (opcode == WebSocket::Opcode::PONG_FRAME) ||
@@ -63,6 +66,49 @@ void generateMask(char output[]) {
     output[i] = static_cast<char>(random(0xFF));
 }
 
+/** @brief Widest word the target loads and stores in one instruction. */
+#if UINTPTR_MAX > 0xFFFFFFFF
+typedef uint64_t __attribute__((__may_alias__)) MaskWord;
+#else
+typedef uint32_t __attribute__((__may_alias__)) MaskWord;
+#endif
+
+void maskData(
+  char *data, size_t length, const char maskingKey[4], size_t maskOffset) {
+  uint8_t *bytes{reinterpret_cast<uint8_t *>(data)};
+  size_t keyIndex{maskOffset & 3};
+
+  // Byte by byte up to a word boundary (Xtensa faults on unaligned words)
+  while (length > 0 &&
+         (reinterpret_cast<uintptr_t>(bytes) & (sizeof(MaskWord) - 1))) {
+    *bytes++ ^= maskingKey[keyIndex];
+    keyIndex = (keyIndex + 1) & 3;
+    --length;
+  }
+
+  if (length >= sizeof(MaskWord)) {
+    // The key rotated to start at keyIndex, repeated over a whole word. A
+    // word is a multiple of 4 bytes, so keyIndex is the same after each one.
+    uint8_t pattern[sizeof(MaskWord)];
+    for (size_t i = 0; i < sizeof(MaskWord); ++i)
+      pattern[i] = maskingKey[(keyIndex + i) & 3];
+    MaskWord key;
+    memcpy(&key, pattern, sizeof(key));
+
+    MaskWord *words{reinterpret_cast<MaskWord *>(bytes)};
+    size_t count{length / sizeof(MaskWord)};
+    for (size_t i = 0; i < count; ++i) words[i] ^= key;
+    bytes += count * sizeof(MaskWord);
+    length -= count * sizeof(MaskWord);
+  }
+
+  while (length > 0) {
+    *bytes++ ^= maskingKey[keyIndex];
+    keyIndex = (keyIndex + 1) & 3;
+    --length;
+  }
+}
+
 /**
  * @see
  * https://github.com/websockets/utf-8-validate/blob/master/src/validation.c
@@ -144,7 +190,7 @@ struct WebSocket::header_t {
   uint8_t opcode;
   bool mask;
   char maskingKey[4]{};
-  uint32_t length;
+  uint64_t length;
 };
 /** @endcond */
 
@@ -178,8 +224,9 @@ void WebSocket::terminate() {
   m_client.flush();
   m_client.stop();
   m_readyState = ReadyState::CLOSED;
-  SAFE_DELETE_ARRAY(m_protocol);
   _clearDataBuffer();
+  m_rxStart = m_rxEnd = 0;
+  m_streamRemaining = 0;
 }
 
 WebSocket::ReadyState WebSocket::getReadyState() const { return m_readyState; }
@@ -188,10 +235,12 @@ bool WebSocket::isAlive() const {
 }
 
 IPAddress WebSocket::getRemoteIP() const { return fetchRemoteIp(m_client); }
-const char *WebSocket::getProtocol() const { return m_protocol; }
+const char *WebSocket::getProtocol() const {
+  return m_protocol[0] ? m_protocol : nullptr;
+}
 
 void WebSocket::send(
-  const WebSocket::DataType dataType, const char *message, uint16_t length) {
+  const WebSocket::DataType dataType, const char *message, size_t length) {
   if (m_readyState != ReadyState::OPEN) {
     // #TODO Trigger error ...
     return;
@@ -216,122 +265,217 @@ void WebSocket::onMessage(const onMessageCallback &callback) {
   _onMessage = callback;
 }
 void WebSocket::onPing(const onPingCallback &callback) { _onPing = callback; }
+void WebSocket::onMessageChunk(const onMessageChunkCallback &callback) {
+  _onMessageChunk = callback;
+}
 
 //
 // Protected:
 //
 
-WebSocket::WebSocket(const NetClient &client, const char *protocol)
-  : m_client{client}, m_readyState{ReadyState::OPEN}, m_maskEnabled{false} {
+WebSocket::WebSocket(const NetClient &client, const char *protocol) {
+  _reset(client, protocol);
+}
+
+void WebSocket::_reset(const NetClient &client, const char *protocol) {
+  m_client = client;
+  // Frames are written whole, so Nagle would only hold back the tail of a
+  // frame larger than the staging buffer
+  m_client.setNoDelay(true);
+  m_readyState = ReadyState::OPEN;
+  m_maskEnabled = false;
+  m_protocol[0] = '\0';
   if (protocol) {
-    m_protocol = new char[strlen(protocol) + 1];
-    strcpy(m_protocol, protocol);
+    strncpy(m_protocol, protocol, kMaxProtocolLength - 1);
+    m_protocol[kMaxProtocolLength - 1] = '\0';
   }
+  _clearDataBuffer();
+  m_rxStart = m_rxEnd = 0;
+  m_streamRemaining = 0;
+  m_metrics = nullptr;
+  m_traceId = 0;
+  _onClose = nullptr;
+  _onMessage = nullptr;
+  _onPing = nullptr;
+  _onMessageChunk = nullptr;
 }
 
-int32_t WebSocket::_read() {
-  const uint32_t timeout{millis() + kTimeoutInterval};
-  while (!m_client.available() && millis() < timeout) {
-    delay(1);
-  }
+bool WebSocket::_read(char *buffer, size_t size, size_t offset) {
+  char *out{buffer + offset};
+  uint32_t timeout{millis() + kTimeoutInterval};
+  while (size > 0) {
+    if (m_rxStart < m_rxEnd) {
+      const size_t count{min<size_t>(size, m_rxEnd - m_rxStart)};
+      memcpy(out, &m_rxBuffer[m_rxStart], count);
+      m_rxStart += count;
+      out += count;
+      size -= count;
+      continue;
+    }
 
-  if (millis() > timeout) {
-    close(PROTOCOL_ERROR, true);
-    return -1;
-  }
+    // Whatever the socket has, in one read. Reads that would fill the receive
+    // buffer anyway go straight to the destination.
+    int32_t received{0};
+    const int available{m_client.available()};
+    if (available > 0) {
+      if (size >= kReceiveBufferSize) {
+        received = m_client.read(reinterpret_cast<uint8_t *>(out),
+          min<size_t>(size, available));
+        if (received > 0) {
+          out += received;
+          size -= received;
+        }
+      } else {
+        received = m_client.read(reinterpret_cast<uint8_t *>(m_rxBuffer),
+          min<size_t>(kReceiveBufferSize, available));
+        if (received > 0) {
+          m_rxStart = 0;
+          m_rxEnd = received;
+        }
+      }
+    }
 
-  return m_client.read();
-}
-bool WebSocket::_read(char *buffer, size_t size, size_t offset) {
-  size_t counter{0};
-  int32_t bite{-1};
-  do {
-    if ((bite = _read()) == -1) return false;
-    buffer[offset + (counter++)] = bite;
-  } while (counter != size);
+    if (received > 0) {
+      timeout = millis() + kTimeoutInterval;
+    } else if (millis() > timeout) {
+      if (m_metrics) m_metrics->timeouts.inc();
+      close(PROTOCOL_ERROR, true);
+      return false;
+    } else {
+      delay(1);
+    }
+  }
 
   return true;
 }
 
 void WebSocket::_send(
-  uint8_t opcode, bool fin, bool mask, const char *data, uint16_t length) {
-  uint16_t bytesWritten{0};
-  bytesWritten += m_client.write(opcode | (fin ? 0x80 : 0x00));
-
-  if (length <= 125) {
-    bytesWritten +=
-      m_client.write((mask ? 0x80 : 0x00) | static_cast<char>(length));
-  } else if (length <= 0xFFFF) {
-    bytesWritten += m_client.write((mask ? 0x80 : 0x00) | 126);
-    bytesWritten += m_client.write(static_cast<char>(length >> 8) & 0xFF);
-    bytesWritten += m_client.write(static_cast<char>(length & 0xFF));
-  } else
-    return; // too big ...
+  uint8_t opcode, bool fin, bool mask, const char *data, size_t length) {
+  // The frame is assembled in the staging buffer so that header and payload
+  // leave in one write (one TCP segment for a small message)
+  uint16_t used{_encodeHeader(m_txBuffer, opcode, fin, mask, length)};
 
 #ifdef _DUMP_HEADER
-  printf(F("TX FRAME : OPCODE=%u, FIN=%s, RSV=0, PAYLOAD-LEN=%u, MASK="),
-    opcode, fin ? "True" : "False", length);
+  printf(F("TX FRAME : OPCODE=%u, FIN=%s, RSV=0, PAYLOAD-LEN=%lu, MASK="),
+    opcode, fin ? "True" : "False", static_cast<unsigned long>(length));
 #endif
 
-  if (mask) {
-    char maskingKey[4]{};
-    generateMask(maskingKey);
-
+  if (!mask) {
 #ifdef _DUMP_HEADER
-    printf(F("%x%x%x%x\n"), maskingKey[0], maskingKey[1], maskingKey[2],
-      maskingKey[3]);
+    printf(F("None\n"));
+#endif
+#ifdef _DUMP_FRAME_DATA
+    if (length) printf(F("%s\n"), data);
 #endif
+    const uint16_t head{
+      static_cast<uint16_t>(min<size_t>(length, kSendBufferSize - used))};
+    if (head) memcpy(&m_txBuffer[used], data, head);
+    // What did not fit goes straight from the caller's buffer
+    _writeFrame(m_txBuffer, used + head, &data[head], length - head, length);
+    return;
+  }
+
+  char maskingKey[4]{};
+  generateMask(maskingKey);
+  memcpy(&m_txBuffer[used], maskingKey, 4);
+  used += 4;
 
-    bytesWritten += m_client.write(maskingKey, 4);
-    for (uint16_t i = 0; i < length; ++i)
-      bytesWritten +=
-        m_client.write(static_cast<char>(data[i] ^ maskingKey[i % 4]));
-  } else {
 #ifdef _DUMP_HEADER
-    printf(F("None\n"));
+  printf(F("%x%x%x%x\n"), maskingKey[0], maskingKey[1], maskingKey[2],
+    maskingKey[3]);
 #endif
 
-    if (length) {
-      bytesWritten +=
-        m_client.write(reinterpret_cast<const char *>(data), length);
-    }
-  }
+  // Masked through the staging buffer, kSendBufferSize bytes per write
+  size_t offset{0};
+  do {
+    const uint16_t count{static_cast<uint16_t>(
+      min<size_t>(length - offset, kSendBufferSize - used))};
+    memcpy(&m_txBuffer[used], &data[offset], count);
+    maskData(&m_txBuffer[used], count, maskingKey, offset);
+    m_client.write(m_txBuffer, used + count);
+    offset += count;
+    used = 0;
+  } while (offset < length);
 
 #ifdef _DUMP_FRAME_DATA
   if (length) printf(F("%s\n"), data);
 #endif
 
+  if (m_metrics) {
+    m_metrics->framesOut.inc();
+    m_metrics->bytesOut.inc(length);
+  }
+}
+
+uint8_t WebSocket::_encodeHeader(
+  char *output, uint8_t opcode, bool fin, bool mask, size_t length) {
+  uint8_t *header{reinterpret_cast<uint8_t *>(output)};
+  uint8_t size{0};
+  header[size++] = opcode | (fin ? 0x80 : 0x00);
+  if (length <= 125) {
+    header[size++] = (mask ? 0x80 : 0x00) | length;
+  } else if (length <= 0xFFFF) {
+    header[size++] = (mask ? 0x80 : 0x00) | 126;
+    header[size++] = (length >> 8) & 0xFF;
+    header[size++] = length & 0xFF;
+  } else {
+    header[size++] = (mask ? 0x80 : 0x00) | 127;
+    const uint64_t extended{length};
+    for (int shift = 56; shift >= 0; shift -= 8)
+      header[size++] = (extended >> shift) & 0xFF;
+  }
+  return size;
+}
+
+void WebSocket::_writeFrame(const char *head, size_t headLength,
+  const char *rest, size_t restLength, size_t payloadLength) {
+  size_t bytesWritten{m_client.write(head, headLength)};
+  if (restLength) bytesWritten += m_client.write(rest, restLength);
+
 #ifdef _DUMP_HEADER
-  printf(F("TX BYTES = %u\n"), bytesWritten);
+  printf(F("TX BYTES = %u\n"), static_cast<unsigned>(bytesWritten));
 #endif
+
+  if (m_metrics) {
+    m_metrics->framesOut.inc();
+    m_metrics->bytesOut.inc(payloadLength);
+  }
 }
 
 void WebSocket::_readFrame() {
   if (m_readyState == ReadyState::CLOSED) return;
+  // In the middle of a streamed frame
+  if (m_streamRemaining > 0) return _readChunk();
 
+  const uint32_t frameStart{millis()};
+  const uint32_t headerStart{WebServerTrace.stamp()};
   header_t header;
   if (!_readHeader(header)) return;
+  const uint32_t payloadStart{WebServerTrace.stamp()};
+  WebServerTrace.record(TRACE_WS_FRAME_HEADER, m_traceId, headerStart, payloadStart);
+
+  if (_onMessageChunk && !isControlFrame(header.opcode))
+    return _beginStreamedFrame(header);
 
-  bool usingTempBuffer = isControlFrame(header.opcode);
-  char *payload{nullptr};
+  // Control payloads are small enough for the stack
+  char controlPayload[kMaxControlPayloadLength + 1]{};
+  char *payload{controlPayload};
   size_t offset{0};
 
-  if (usingTempBuffer) {
-    payload = new char[header.length + 1]{};
-  } else {
+  if (!isControlFrame(header.opcode)) {
     payload = m_dataBuffer;
     offset = m_currentOffset;
 
     if (header.length + offset >= kBufferMaxSize)
-      return close(CloseCode::MESSAGE_TOO_BIG, true);
+      return _fail(CloseCode::MESSAGE_TOO_BIG);
   }
 
   if (header.length > 0) {
-    if (!_readData(header, payload, offset)) {
-      if (usingTempBuffer) SAFE_DELETE_ARRAY(payload);
-      return;
-    }
+    if (!_readData(header, payload, offset)) return;
   }
+  const uint32_t dispatchStart{WebServerTrace.stamp()};
+  WebServerTrace.record(
+    TRACE_WS_FRAME_PAYLOAD, m_traceId, payloadStart, dispatchStart);
 
   switch (header.opcode) {
   case Opcode::CONTINUATION_FRAME: {
@@ -359,12 +503,19 @@ void WebSocket::_readFrame() {
   }
   default: {
     __debugOutput(F("Unrecognized frame opcode: %u\n"), header.opcode);
-    close(PROTOCOL_ERROR, true);
+    _fail(PROTOCOL_ERROR);
     break;
   }
   }
 
-  if (usingTempBuffer) SAFE_DELETE_ARRAY(payload);
+  WebServerTrace.record(
+    TRACE_WS_DISPATCH, m_traceId, dispatchStart, WebServerTrace.stamp());
+
+  if (m_metrics) {
+    m_metrics->framesIn.inc();
+    m_metrics->bytesIn.inc(header.length);
+    m_metrics->frameLatency.observe(millis() - frameStart);
+  }
 }
 bool WebSocket::_readHeader(header_t &header) {
   char temp[2]{};
@@ -381,7 +532,7 @@ bool WebSocket::_readHeader(header_t &header) {
     __debugOutput(F("RSV1 = %d, RSV2 = %d, RSV3 = %d\n"), header.rsv1,
       header.rsv2, header.rsv3);
 
-    close(PROTOCOL_ERROR, true);
+    _fail(PROTOCOL_ERROR);
     return false;
   }
 
@@ -392,37 +543,43 @@ bool WebSocket::_readHeader(header_t &header) {
     if (!header.fin) {
       __debugOutput(F("Control frames must not be fragmented!\n"));
 
-      close(PROTOCOL_ERROR, true);
+      _fail(PROTOCOL_ERROR);
       return false;
     }
 
-    if (header.length > 125) {
+    if (header.length > kMaxControlPayloadLength) {
       __debugOutput(
         F("Control frames max length = 125, here = %u\n"), header.length);
 
-      close(PROTOCOL_ERROR, true);
+      _fail(PROTOCOL_ERROR);
       return false;
     }
   }
 
-  int32_t bite{-1};
   if (header.length == 126) {
-    if ((bite = _read()) == -1) return false;
-    header.length = bite << 8;
-    if ((bite = _read()) == -1) return false;
-
-    header.length |= bite;
+    uint8_t extended[2]{};
+    if (!_read(reinterpret_cast<char *>(extended), 2)) return false;
+    header.length = (extended[0] << 8) | extended[1];
   } else if (header.length == 127) {
-    __debugOutput(F("Unsupported frame size!\n"));
+    uint8_t extended[8]{};
+    if (!_read(reinterpret_cast<char *>(extended), 8)) return false;
+    if (extended[0] & 0x80) {
+      __debugOutput(F("Most significant bit of a 64-bit length must be 0!\n"));
 
-    close(MESSAGE_TOO_BIG, true);
-    return false;
+      _fail(PROTOCOL_ERROR);
+      return false;
+    }
+    header.length = 0;
+    for (const auto byte : extended) header.length = (header.length << 8) | byte;
   }
 
-  if (header.length > kBufferMaxSize) {
-    __debugOutput(F("Unsupported frame size = %u\n"), header.length);
+  // A chunk handler takes data frames of any size
+  if (header.length > kBufferMaxSize &&
+      !(_onMessageChunk && !isControlFrame(header.opcode))) {
+    __debugOutput(F("Unsupported frame size = %lu\n"),
+      static_cast<unsigned long>(header.length));
 
-    close(MESSAGE_TOO_BIG, true);
+    _fail(MESSAGE_TOO_BIG);
     return false;
   }
 
@@ -430,8 +587,9 @@ bool WebSocket::_readHeader(header_t &header) {
     if (!_read(header.maskingKey, 4)) return false;
 
 #ifdef _DUMP_HEADER
-  printf(F("RX FRAME : OPCODE=%u, FIN=%s, RSV=%d, PAYLOAD-LEN=%u, MASK="),
-    header.opcode, header.fin ? "True" : "False", header.rsv1, header.length);
+  printf(F("RX FRAME : OPCODE=%u, FIN=%s, RSV=%d, PAYLOAD-LEN=%lu, MASK="),
+    header.opcode, header.fin ? "True" : "False", header.rsv1,
+    static_cast<unsigned long>(header.length));
 
   !header.mask
     ? printf(F("None\n"))
@@ -443,18 +601,9 @@ bool WebSocket::_readHeader(header_t &header) {
 }
 bool WebSocket::_readData(
   const header_t &header, char *payload, size_t offset) {
-  int32_t bite{-1};
-
-  if (header.mask) {
-    for (uint32_t i = 0; i < header.length; ++i) {
-      if ((bite = _read()) == -1) return false;
-      payload[offset + i] = bite ^ header.maskingKey[i % 4];
-    }
-  } else {
-    if (!_read(payload, header.length, offset)) {
-      return false;
-    }
-  }
+  if (!_read(payload, header.length, offset)) return false;
+  if (header.mask)
+    maskData(&payload[offset], header.length, header.maskingKey);
 
 #ifdef _DUMP_FRAME_DATA
   if (header.length) printf(F("%s\n"), payload);
@@ -463,6 +612,63 @@ bool WebSocket::_readData(
   return true;
 }
 
+void WebSocket::_beginStreamedFrame(const header_t &header) {
+  if (header.opcode == CONTINUATION_FRAME) {
+    if (m_tbcOpcode == -1) return _fail(PROTOCOL_ERROR);
+  } else {
+    if (m_tbcOpcode != -1) return _fail(PROTOCOL_ERROR);
+    m_tbcOpcode = header.opcode;
+    m_streamFirst = true;
+  }
+
+  m_streamRemaining = header.length;
+  memcpy(m_streamMaskingKey, header.maskingKey, 4);
+  m_streamMaskOffset = 0;
+  m_streamMasked = header.mask;
+  m_streamFin = header.fin;
+
+  if (m_metrics) m_metrics->framesIn.inc();
+  if (header.length == 0) return _deliverChunk(0);
+  _readChunk();
+}
+void WebSocket::_readChunk() {
+  // Only what has already arrived, so that a large message does not hold up
+  // the other connections
+  const int available{m_client.available()};
+  const size_t ready{static_cast<size_t>(m_rxEnd - m_rxStart) +
+                     (available > 0 ? static_cast<size_t>(available) : 0)};
+  const uint16_t length{static_cast<uint16_t>(min<uint64_t>(
+    m_streamRemaining, min<size_t>(ready, kBufferMaxSize)))};
+  if (length == 0) return;
+
+  if (!_read(m_dataBuffer, length)) return;
+  if (m_streamMasked)
+    maskData(m_dataBuffer, length, m_streamMaskingKey, m_streamMaskOffset);
+  m_streamMaskOffset = (m_streamMaskOffset + length) & 3;
+  m_streamRemaining -= length;
+
+  if (m_metrics) m_metrics->bytesIn.inc(length);
+  _deliverChunk(length);
+}
+void WebSocket::_deliverChunk(uint16_t length) {
+  const bool isFirst{m_streamFirst};
+  const bool isFinal{m_streamFin && m_streamRemaining == 0};
+  const auto dataType =
+    m_tbcOpcode == Opcode::TEXT_FRAME ? DataType::TEXT : DataType::BINARY;
+  m_streamFirst = false;
+  if (isFinal) m_tbcOpcode = -1;
+
+  // Empty frames in the middle of a message carry nothing worth a call
+  if ((length == 0 && !isFirst && !isFinal) || !_onMessageChunk) return;
+  MemoryScope scope{MEMORY_HANDLER};
+  _onMessageChunk(*this, dataType, m_dataBuffer, length, isFirst, isFinal);
+}
+
+void WebSocket::_fail(const CloseCode code) {
+  if (m_metrics) m_metrics->protocolErrors.inc();
+  close(code, true);
+}
+
 void WebSocket::_clearDataBuffer() {
   memset(m_dataBuffer, '\0', kBufferMaxSize);
   m_currentOffset = 0;
@@ -470,7 +676,7 @@ void WebSocket::_clearDataBuffer() {
 }
 
 void WebSocket::_handleContinuationFrame(const header_t &header) {
-  if (m_tbcOpcode == -1) return close(PROTOCOL_ERROR, true);
+  if (m_tbcOpcode == -1) return _fail(PROTOCOL_ERROR);
 
   if (header.fin) {
     const auto totalLength = m_currentOffset + header.length;
@@ -479,10 +685,11 @@ void WebSocket::_handleContinuationFrame(const header_t &header) {
     if (dataType == DataType::TEXT) {
       if (!isValidUTF8(
             reinterpret_cast<const byte *>(m_dataBuffer), totalLength))
-        return close(INVALID_FRAME_PAYLOAD_DATA, true);
+        return _fail(INVALID_FRAME_PAYLOAD_DATA);
     }
 
     if (_onMessage) {
+      MemoryScope scope{MEMORY_HANDLER};
       _onMessage(*this, dataType, m_dataBuffer, totalLength);
     }
     _clearDataBuffer();
@@ -491,7 +698,7 @@ void WebSocket::_handleContinuationFrame(const header_t &header) {
   }
 }
 void WebSocket::_handleDataFrame(const header_t &header) {
-  if (m_currentOffset > 0) return close(PROTOCOL_ERROR, true);
+  if (m_currentOffset > 0) return _fail(PROTOCOL_ERROR);
 
   if (header.fin) {
     const auto dataType =
@@ -500,10 +707,11 @@ void WebSocket::_handleDataFrame(const header_t &header) {
     if (dataType == DataType::TEXT) {
       if (!isValidUTF8(
             reinterpret_cast<const byte *>(m_dataBuffer), header.length))
-        return close(INVALID_FRAME_PAYLOAD_DATA, true);
+        return _fail(INVALID_FRAME_PAYLOAD_DATA);
     }
 
     if (_onMessage) {
+      MemoryScope scope{MEMORY_HANDLER};
       _onMessage(*this, dataType, m_dataBuffer, header.length);
     }
     _clearDataBuffer();
@@ -521,12 +729,12 @@ void WebSocket::_handleCloseFrame(const header_t &header, const char *payload) {
     for (byte i = 0; i < 2; ++i)
       code = (code << 8) + (payload[i] & 0xFF);
 
-    if (!isCloseCodeValid(code)) return close(PROTOCOL_ERROR, true);
+    if (!isCloseCodeValid(code)) return _fail(PROTOCOL_ERROR);
 
     reasonLength = header.length - 2;
     reason = &payload[2];
     if (!isValidUTF8(reinterpret_cast<const byte *>(reason), reasonLength))
-      return close(PROTOCOL_ERROR, true);
+      return _fail(PROTOCOL_ERROR);
   }
 
   __debugOutput(F("Received close frame: code = %u, reason = %s\n"), code,
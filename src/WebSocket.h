@@ -17,6 +17,9 @@
 /** @file */
 
 #include "utility.h"
+#include "DIYables_ESP32_Metrics.h"
+#include "DIYables_ESP32_Trace.h"
+#include "DIYables_ESP32_Memory.h"
 
 namespace net {
 
@@ -26,6 +29,14 @@ namespace net {
  * @param[out] output Array of 29 elements (including NULL).
  */
 bool encodeSecKey(const char *key, char output[]);
+/** @return true if the given bytes are a complete, valid UTF-8 sequence. */
+bool isValidUTF8(const byte *s, size_t length);
+/**
+ * @brief XORs data with a masking key (RFC 6455 5.3), in place.
+ * @param maskOffset Index of the first byte within the frame payload.
+ */
+void maskData(
+  char *data, size_t length, const char maskingKey[4], size_t maskOffset = 0);
 
 /**
  * Error codes.
@@ -58,6 +69,7 @@ enum class WebSocketError {
  */
 class WebSocket {
   friend class WebSocketServer;
+  friend class ::DIYables_ESP32_Memory; // builds the server's connection pool
   struct header_t;
 
 public:
@@ -203,6 +215,18 @@ public:
   using onPingCallback = void (*)(
     WebSocket &ws, const char *message, uint16_t length);
 
+  /**
+   * @param ws Source of a message.
+   * @param dataType Type of the message the chunk belongs to.
+   * @param data Non NULL-terminated, valid only during the call.
+   * @param length Number of data bytes (at most kBufferMaxSize, might be 0).
+   * @param isFirst The chunk starts a message.
+   * @param isFinal The chunk ends a message.
+   */
+  using onMessageChunkCallback = void (*)(WebSocket &ws,
+    const DataType dataType, const char *data, uint16_t length, bool isFirst,
+    bool isFinal);
+
 public:
   WebSocket(const WebSocket &) = delete;
   virtual ~WebSocket();
@@ -237,7 +261,7 @@ public:
    * @brief Sends a message frame.
    * @param message Doesn't have to be NULL-terminated.
    */
-  void send(const DataType, const char *message, uint16_t length);
+  void send(const DataType, const char *message, size_t length);
   /**
    * @brief Sends a ping message.
    * @param payload An additional message, doesn't have to be NULL-terminated.
@@ -269,24 +293,67 @@ public:
 
   void onPing(const onPingCallback &);
 
+  /**
+   * @brief Sets a handler that receives data messages piece by piece as they
+   * arrive, instead of onMessage. Messages of any length (up to 2^63 bytes)
+   * are accepted, only kBufferMaxSize bytes are held at a time.
+   * @remark Text messages are not checked for valid UTF-8 in this mode.
+   * @code{.cpp}
+   * ws.onMessageChunk([](WebSocket &ws, const WebSocket::DataType dataType,
+   *                    const char *data, uint16_t length, bool isFirst,
+   *                    bool isFinal) {
+   *   // write data to flash ...
+   * });
+   * @endcode
+   */
+  void onMessageChunk(const onMessageChunkCallback &);
+
 protected:
   /** @remark Reserved for WebSocketClient. */
   WebSocket() = default;
   /** @remark Reserved for WebSocketServer. */
   WebSocket(const NetClient &, const char *protocol);
 
+  /**
+   * @brief Turns a pooled (closed) object into a fresh server-side connection.
+   * @remark Reserved for WebSocketServer.
+   */
+  void _reset(const NetClient &, const char *protocol);
+
   /** @cond */
-  int32_t _read();
+  /** @brief Reads exactly size bytes, through the receive buffer. */
   bool _read(char *buffer, size_t size, size_t offset = 0);
+  /** @return Whether received bytes are waiting to be decoded. */
+  bool _hasBufferedData() const { return m_rxStart < m_rxEnd; }
 
   void _send(
-    uint8_t opcode, bool fin, bool mask, const char *data, uint16_t length);
+    uint8_t opcode, bool fin, bool mask, const char *data, size_t length);
+  /**
+   * @brief Writes the frame header (without masking key) to output.
+   * @param output At least 10 bytes.
+   * @return Header size.
+   */
+  static uint8_t _encodeHeader(
+    char *output, uint8_t opcode, bool fin, bool mask, size_t length);
+  /**
+   * @brief Writes an encoded, unmasked frame: head holds the header and the
+   * start of the payload, rest the remainder of the payload.
+   */
+  void _writeFrame(const char *head, size_t headLength, const char *rest,
+    size_t restLength, size_t payloadLength);
 
   void _readFrame();
   bool _readHeader(header_t &);
   bool _readData(const header_t &, char *payload, size_t offset = 0);
+  /** @brief Starts passing a data frame to the chunk handler. */
+  void _beginStreamedFrame(const header_t &);
+  /** @brief Passes on the part of a streamed frame that has arrived. */
+  void _readChunk();
+  void _deliverChunk(uint16_t length);
 
   void _clearDataBuffer();
+  /** @brief Closes the connection because of invalid input from endpoint. */
+  void _fail(const CloseCode);
 
   void _handleContinuationFrame(const header_t &);
   void _handleDataFrame(const header_t &);
@@ -295,20 +362,42 @@ protected:
 protected:
   mutable NetClient m_client;
   ReadyState m_readyState{ReadyState::CLOSED};
-  char *m_protocol{nullptr};
+  char m_protocol[kMaxProtocolLength]{};
 
   /** @note A client endpoint must always mask frames. */
   bool m_maskEnabled{true};
 
   char m_dataBuffer[kBufferMaxSize]{};
+  /** @brief Bytes taken from the socket, m_rxStart..m_rxEnd not decoded yet. */
+  char m_rxBuffer[kReceiveBufferSize]{};
+  uint16_t m_rxStart{0};
+  uint16_t m_rxEnd{0};
+  /** @brief Outgoing payload is masked here before it is written. */
+  char m_txBuffer[kSendBufferSize]{};
   uint16_t m_currentOffset{0};
   /// Indicates an opcode (text/binary) that should be continued by continuation
   /// frame.
   int8_t m_tbcOpcode{-1};
 
+  /** @brief Payload bytes of the streamed frame not read yet. */
+  uint64_t m_streamRemaining{0};
+  char m_streamMaskingKey[4]{};
+  /** @brief Position in the streamed frame's payload, for unmasking. */
+  uint8_t m_streamMaskOffset{0};
+  bool m_streamMasked{false};
+  bool m_streamFin{false};
+  /** @brief The next chunk delivered starts a message. */
+  bool m_streamFirst{false};
+
+  /** @remark Owned by WebSocketServer, might be NULL. */
+  WebSocketMetrics *m_metrics{nullptr};
+  /** @brief Slot index in WebSocketServer, used to tag trace events. */
+  uint16_t m_traceId{0};
+
   onCloseCallback _onClose{nullptr};
   onMessageCallback _onMessage{nullptr};
   onPingCallback _onPing{nullptr};
+  onMessageChunkCallback _onMessageChunk{nullptr};
 };
 
 /** @cond */
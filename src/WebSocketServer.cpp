@@ -18,20 +18,31 @@
 
 namespace net {
 
-WebSocketServer::WebSocketServer(uint16_t port) : m_server{port} {}
-WebSocketServer::~WebSocketServer() { shutdown(); }
+WebSocketServer::WebSocketServer(uint16_t port)
+  : m_server{port}, m_port{port} {}
+WebSocketServer::~WebSocketServer() {
+  shutdown();
+  WebServerMemory.destroyArray(m_pool, kMaxConnections);
+}
 
 void WebSocketServer::begin(const verifyClientCallback &verifyClient,
   const protocolHandlerCallback &protocolHandler) {
   _verifyClient = verifyClient;
   _protocolHandler = protocolHandler;
-  m_server.begin();
+  // Every connection object is built here, once; connections reuse them
+  if (!m_pool) {
+    m_pool = WebServerMemory.createArray<WebSocket>(
+      MEMORY_WEBSOCKET, kMaxConnections);
+    if (!m_pool) Serial.println("[WebSocketServer] No memory for connections");
+  }
+  if (m_port != 0) m_server.begin();
 }
 void WebSocketServer::shutdown() {
-  for (auto ws : m_sockets) {
+  for (auto &ws : m_sockets) {
     if (ws) {
       ws->close(WebSocket::CloseCode::GOING_AWAY, true);
-      SAFE_DELETE(ws);
+      ws->terminate();
+      ws = nullptr;
     }
   }
 
@@ -41,47 +52,109 @@ void WebSocketServer::shutdown() {
 }
 
 void WebSocketServer::broadcast(
-  const WebSocket::DataType dataType, const char *message, uint16_t length) {
+  const WebSocket::DataType dataType, const char *message, size_t length) {
+  if (countClients() == 0) return;
+
+  // Server frames are not masked, so every client gets the same bytes: the
+  // header is encoded once, with as much of the payload as fits the stack
+  // buffer, and each client gets that plus the payload tail (no copy, no
+  // allocation, whatever the message size).
+  char frame[kSendBufferSize];
+  const uint8_t headerLength{WebSocket::_encodeHeader(frame,
+    dataType == WebSocket::DataType::TEXT ? WebSocket::TEXT_FRAME
+                                          : WebSocket::BINARY_FRAME,
+    true, false, length)};
+  const size_t head{min<size_t>(length, sizeof(frame) - headerLength)};
+  if (head) memcpy(&frame[headerLength], message, head);
+
   for (auto ws : m_sockets)
     if (ws && ws->getReadyState() == WebSocket::ReadyState::OPEN)
-      ws->send(dataType, message, length);
+      ws->_writeFrame(frame, headerLength + head, &message[head],
+        length - head, length);
 }
 
 void WebSocketServer::listen() {
   _cleanDeadConnections();
 
-  if (auto client = m_server.available(); client) {
+  const uint32_t acceptStart{WebServerTrace.stamp()};
+  NetClient client{};
+  if (m_port != 0) client = m_server.available();
+  if (client) {
     if (auto ws = _getWebSocket(client); !ws) {
       // A new client
       bool clientRequestFailed = false;
       for (auto &it : m_sockets) {
-        if (!it) {
-          char selectedProtocol[32]{};
+        if (!it && m_pool) {
+          char selectedProtocol[kMaxProtocolLength]{};
           if (_handleRequest(client, selectedProtocol)) {
-            ws = it = new WebSocket{
-              client, *selectedProtocol ? selectedProtocol : nullptr};
-            if (_onConnection) _onConnection(*ws);
+            ws = _addClient(it, client, selectedProtocol, acceptStart);
           } else {
             Serial.println("[WebSocketServer] Handshake failed");
+            m_metrics.handshakeFailures.inc();
             clientRequestFailed = true;
+            WebServerTrace.record(TRACE_WS_HANDSHAKE, &it - m_sockets,
+              acceptStart, WebServerTrace.stamp());
           }
           break;
         }
       }
       if (!clientRequestFailed && !ws) {
         // Server is full
+        m_metrics.rejectedFull.inc();
         _rejectRequest(client, WebSocketError::SERVICE_UNAVAILABLE);
       }
     } else {
     }
   }
   for (auto it : m_sockets) {
-    if (it && it->m_client.connected() && it->m_client.available()) {
+    if (it && (it->_hasBufferedData() ||
+                (it->m_client.connected() && it->m_client.available()))) {
       it->_readFrame();
     }
   }
 }
 
+WebSocket *WebSocketServer::accept(NetClient &client, const char *headers) {
+  _cleanDeadConnections();
+
+  const uint32_t acceptStart{WebServerTrace.stamp()};
+  char secKey[32]{};
+  char protocols[kMaxProtocolListLength + 1]{};
+  const auto errorCode = _checkHeaders(client, headers, secKey, protocols);
+  if (errorCode != WebSocketError::NO_ERROR) {
+    m_metrics.handshakeFailures.inc();
+    _rejectRequest(client, errorCode);
+    return nullptr;
+  }
+
+  for (auto &it : m_sockets) {
+    if (!it && m_pool) {
+      char selectedProtocol[kMaxProtocolLength]{};
+      _selectProtocol(protocols, selectedProtocol);
+      _acceptRequest(client, secKey, selectedProtocol);
+      return _addClient(it, client, selectedProtocol, acceptStart);
+    }
+  }
+
+  // Server is full
+  m_metrics.rejectedFull.inc();
+  _rejectRequest(client, WebSocketError::SERVICE_UNAVAILABLE);
+  return nullptr;
+}
+
+void WebSocketServer::watch(SocketPoller &poller, uint8_t group) {
+  if (m_port != 0) poller.watchServer(m_server, group);
+  for (auto ws : m_sockets) {
+    if (!ws) continue;
+    if (ws->_hasBufferedData())
+      poller.wakeAfter(0, group); // next frame already received
+    else if (ws->isAlive())
+      poller.watchClient(ws->m_client, group);
+    else
+      poller.wakeAfter(0, group); // to be cleaned up
+  }
+}
+
 uint8_t WebSocketServer::countClients() const {
   uint8_t count{0};
   for (auto ws : m_sockets)
@@ -90,9 +163,16 @@ uint8_t WebSocketServer::countClients() const {
   return count;
 }
 
+const WebSocketMetrics &WebSocketServer::getMetrics() const {
+  return m_metrics;
+}
+
 void WebSocketServer::onConnection(const onConnectionCallback &callback) {
   _onConnection = callback;
 }
+void WebSocketServer::onVerifyClient(const verifyClientCallback &callback) {
+  _verifyClient = callback;
+}
 
 WebSocket *WebSocketServer::_getWebSocket(NetClient &client) const {
   for (auto ws : m_sockets)
@@ -101,6 +181,98 @@ WebSocket *WebSocketServer::_getWebSocket(NetClient &client) const {
   return nullptr;
 }
 
+WebSocket *WebSocketServer::_addClient(WebSocket *&slot, NetClient &client,
+  const char *protocol, uint32_t acceptStart) {
+  const uint16_t index = &slot - m_sockets;
+  auto ws = slot = &m_pool[index];
+  ws->_reset(client, *protocol ? protocol : nullptr);
+  ws->m_metrics = &m_metrics;
+  ws->m_traceId = index;
+  m_metrics.connections.inc();
+  m_metrics.openConnections.inc();
+  if (_onConnection) _onConnection(*ws);
+  WebServerTrace.record(
+    TRACE_WS_HANDSHAKE, index, acceptStart, WebServerTrace.stamp());
+  return ws;
+}
+
+void WebSocketServer::_selectProtocol(
+  char *protocols, char selectedProtocol[]) {
+  selectedProtocol[0] = '\0';
+  if (*protocols) {
+    char *rest{protocols};
+    const char *protocol{_protocolHandler ? _protocolHandler(protocols)
+                                          : strtok_r(protocols, ",", &rest)};
+    if (protocol && strlen(protocol) < kMaxProtocolLength)
+      strcpy(selectedProtocol, protocol);
+  }
+}
+bool WebSocketServer::_appendProtocols(
+  char protocols[], const char *value, size_t length) {
+  size_t used{strlen(protocols)};
+  if (used && length) {
+    if (used >= kMaxProtocolListLength) return false;
+    protocols[used++] = ',';
+  }
+  for (size_t i{0}; i < length; ++i) {
+    if (value[i] == ' ') continue;
+    if (used >= kMaxProtocolListLength) return false;
+    protocols[used++] = value[i];
+  }
+  protocols[used] = '\0';
+  return true;
+}
+WebSocketError WebSocketServer::_checkHeaders(NetClient &client,
+  const char *headers, char secKey[], char protocols[]) {
+  secKey[0] = protocols[0] = '\0';
+  uint8_t version{0};
+
+  // The request line was checked by the HTTP server; the headers are walked
+  // in place, nothing is copied but what is kept
+  HeaderField field;
+  const char *line{firstHeader(headers)};
+  while ((line = nextHeader(line, field))) {
+    if (isHeader(field, "Sec-WebSocket-Key")) {
+      if (!_isValidSecKey(field.value, field.valueLength))
+        return WebSocketError::BAD_REQUEST;
+      memcpy(secKey, field.value, field.valueLength);
+      secKey[field.valueLength] = '\0';
+    } else if (isHeader(field, "Sec-WebSocket-Version")) {
+      version = _parseVersion(field.value, field.valueLength);
+      if (!_isValidVersion(version)) return WebSocketError::BAD_REQUEST;
+    } else if (isHeader(field, "Sec-WebSocket-Protocol")) {
+      if (!_appendProtocols(protocols, field.value, field.valueLength))
+        return WebSocketError::BAD_REQUEST;
+    } else if (field.nameLength > 0 && !isHeader(field, "Host") &&
+               !isHeader(field, "Upgrade") && !isHeader(field, "Connection")) {
+      if (!_verifyHeader(client, field))
+        return WebSocketError::CONNECTION_REFUSED;
+    }
+  }
+  if (!secKey[0] || !_isValidVersion(version))
+    return WebSocketError::BAD_REQUEST;
+  return WebSocketError::NO_ERROR;
+}
+bool WebSocketServer::_verifyHeader(
+  NetClient &client, const HeaderField &field) {
+  if (!_verifyClient) return true;
+
+  // Same arguments as _handleRequest() passes: the name and the first word
+  // of the value. Refused rather than shortened if they do not fit.
+  char name[kMaxHeaderLineLength];
+  char value[kMaxHeaderLineLength];
+  size_t valueLength{0};
+  while (valueLength < field.valueLength && field.value[valueLength] != ' ')
+    ++valueLength;
+  if (field.nameLength >= sizeof(name) || valueLength >= sizeof(value))
+    return false;
+  memcpy(name, field.name, field.nameLength);
+  name[field.nameLength] = '\0';
+  memcpy(value, field.value, valueLength);
+  value[valueLength] = '\0';
+  return _verifyClient(fetchRemoteIp(client), name, value);
+}
+
 //
 // Read client request:
 //
@@ -125,11 +297,11 @@ bool WebSocketServer::_handleRequest(
   //  Edge: 'User-Agent' = ~141 characters
   //  Firefox: 'User-Agent' = ~90 characters
   //  Opera: 'User-Agent' = ~145 characters
-  char buffer[160]{};
+  char buffer[kMaxHeaderLineLength]{};
 
   char secKey[32]{}; // Holds client Sec-WebSocket-Key
   uint8_t flags{0};
-  char protocols[32]{};
+  char protocols[kMaxProtocolListLength + 1]{};
 
   int32_t bite{-1};
   byte currentLine{0};
@@ -137,6 +309,11 @@ bool WebSocketServer::_handleRequest(
 
   while ((bite = client.read()) != -1) {
     buffer[counter++] = bite;
+    if (bite != '\n' && counter >= sizeof(buffer) - 1) {
+      // Too long for the buffer; rejected rather than cut off
+      _rejectRequest(client, WebSocketError::BAD_REQUEST);
+      return false;
+    }
 
     if (bite == '\n') {
       const auto lineBreakPos = static_cast<uint8_t>(strcspn(buffer, "\r\n"));
@@ -197,7 +374,11 @@ bool WebSocketServer::_handleRequest(
 
           else if (strcasecmp_P(header, (PGM_P)F("Sec-WebSocket-Key")) == 0) {
             value = strtok_r(rest, " ", &rest);
-            if (value) strcpy(secKey, value);
+            if (!value || !_isValidSecKey(value, strlen(value))) {
+              _rejectRequest(client, WebSocketError::BAD_REQUEST);
+              return false;
+            }
+            strcpy(secKey, value);
           }
 
           //
@@ -207,7 +388,8 @@ bool WebSocketServer::_handleRequest(
           else if (strcasecmp_P(header, (PGM_P)F("Sec-WebSocket-Version")) ==
                    0) {
             value = strtok_r(rest, " ", &rest);
-            if (!value || !_isValidVersion(atoi(value))) {
+            if (!value ||
+                !_isValidVersion(_parseVersion(value, strlen(value)))) {
               _rejectRequest(client, WebSocketError::BAD_REQUEST);
               return false;
             }
@@ -220,10 +402,10 @@ bool WebSocketServer::_handleRequest(
 
           else if (strcasecmp_P(header, (PGM_P)F("Sec-WebSocket-Protocol")) ==
                    0) {
-            for (byte i = 0; rest != nullptr; ++i) {
-              if (*protocols) strcat(protocols, ",");
-              const auto pch = strtok_r(rest, ",", &rest);
-              strcat(protocols, pch + 1); // Skip leading whitespace
+            // Rejected rather than cut off, which could change the choice
+            if (rest && !_appendProtocols(protocols, rest, strlen(rest))) {
+              _rejectRequest(client, WebSocketError::BAD_REQUEST);
+              return false;
             }
           }
 
@@ -253,12 +435,7 @@ bool WebSocketServer::_handleRequest(
             return false;
           }
 
-          selectedProtocol[0] = '\0';
-          if (*protocols) {
-            strcpy(selectedProtocol, _protocolHandler
-                                       ? _protocolHandler(protocols)
-                                       : strtok_r(protocols, ",", &rest));
-          }
+          _selectProtocol(protocols, selectedProtocol);
           _acceptRequest(client, secKey, selectedProtocol);
           return true;
         }
@@ -325,6 +502,24 @@ bool WebSocketServer::_isValidVersion(uint8_t version) {
   }
   return false;
 }
+uint8_t WebSocketServer::_parseVersion(const char *value, size_t length) {
+  if (length == 0 || length > 2) return 0; // "269" must not wrap to 13
+  uint8_t version{0};
+  for (size_t i{0}; i < length; ++i) {
+    if (!isdigit(static_cast<unsigned char>(value[i]))) return 0;
+    version = version * 10 + (value[i] - '0');
+  }
+  return version;
+}
+bool WebSocketServer::_isValidSecKey(const char *value, size_t length) {
+  // encodeSecKey() hashes exactly 24 characters
+  if (length != 24 || value[22] != '=' || value[23] != '=') return false;
+  for (size_t i{0}; i < 22; ++i)
+    if (!isalnum(static_cast<unsigned char>(value[i])) && value[i] != '+' &&
+        value[i] != '/')
+      return false;
+  return true;
+}
 WebSocketError WebSocketServer::_validateHandshake(
   uint8_t flags, const char *secKey) {
   if ((flags & (kValidConnectionHeader | kValidUpgradeHeader)) !=
@@ -401,8 +596,9 @@ void WebSocketServer::_acceptRequest(
 void WebSocketServer::_cleanDeadConnections() {
   for (auto &it : m_sockets) {
     if (it && !it->isAlive()) {
-      delete it;
+      it->terminate(); // back to the pool
       it = nullptr;
+      m_metrics.openConnections.dec();
     }
   }
 }
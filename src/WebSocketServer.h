@@ -18,6 +18,7 @@
 
 #include "WebSocket.h"
 #include "utility.h"
+#include "DIYables_ESP32_Poll.h"
 
 namespace net {
 
@@ -40,6 +41,8 @@ public:
   /**
    * @brief Initializes server on given port.
    * @note Don't forget to call begin()
+   * @param port 0 for a server without listening socket, that only takes
+   * connections handed over with accept().
    */
   WebSocketServer(uint16_t port = 3000);
   WebSocketServer(const WebSocketServer &) = delete;
@@ -61,6 +64,9 @@ public:
    * @endcode
    * @param callback Function called for every header during hadshake (except
    * for those required by protocol, like **Connection**, **Upgrade** etc.)
+   * @note The first call also builds the pool of kMaxConnections connection
+   * objects; connecting and disconnecting clients never touch the heap after
+   * that.
    */
   void begin(const verifyClientCallback &verifyClient = nullptr,
     const protocolHandlerCallback &protocolHandler = nullptr);
@@ -69,14 +75,33 @@ public:
 
   /** @brief Sends message to all connected clients. */
   void broadcast(
-    const WebSocket::DataType dataType, const char *message, uint16_t length);
+    const WebSocket::DataType dataType, const char *message, size_t length);
 
   /** @note Call this in main loop. */
   void listen();
+  /**
+   * @brief Takes over a connection whose handshake request was already read
+   * and checked (Upgrade/Connection headers) by an HTTP server, e.g. for
+   * WebSocket on the HTTP port. The handshake headers get the same checks as
+   * on the server's own port (key, version, verifyClient, subprotocol list),
+   * then the handshake is answered.
+   * @param headers The request as received (request line and headers).
+   * @return Connected client, or nullptr when the request was rejected (the
+   * connection is closed then).
+   */
+  WebSocket *accept(NetClient &client, const char *headers);
+  /**
+   * @brief Registers the listening socket and the connected clients, so that
+   * a SocketPoller wakes up when listen() has something to do.
+   */
+  void watch(SocketPoller &poller, uint8_t group);
 
   /** @return Amount of connected clients. */
   uint8_t countClients() const;
 
+  /** @return Counters and histograms collected by this server. */
+  const WebSocketMetrics &getMetrics() const;
+
   /**
    * @brief
    * @code{.cpp}
@@ -97,10 +122,34 @@ public:
    * connected client.
    */
   void onConnection(const onConnectionCallback &callback);
+  /**
+   * @brief Replaces the verifyClient function given to begin(), e.g. for a
+   * server that was started already.
+   */
+  void onVerifyClient(const verifyClientCallback &callback);
 
 private:
   /** @cond */
   WebSocket *_getWebSocket(NetClient &) const;
+  WebSocket *_addClient(
+    WebSocket *&slot, NetClient &, const char *protocol, uint32_t acceptStart);
+  void _selectProtocol(char *protocols, char selectedProtocol[]);
+  /**
+   * @brief Appends a Sec-WebSocket-Protocol value to the list, without
+   * spaces.
+   * @return false if the list would exceed kMaxProtocolListLength.
+   */
+  bool _appendProtocols(char protocols[], const char *value, size_t length);
+  /**
+   * @brief Checks the headers of a request read by an HTTP server the way
+   * _handleRequest() checks them.
+   * @param[out] secKey Sec-WebSocket-Key value.
+   * @param[out] protocols Requested subprotocols.
+   */
+  WebSocketError _checkHeaders(NetClient &, const char *headers,
+    char secKey[], char protocols[]);
+  /** @brief Hands a header to verifyClient (if any). */
+  bool _verifyHeader(NetClient &, const HeaderField &field);
 
   /// @param[out] protocol
   bool _handleRequest(NetClient &, char selectedProtocol[]);
@@ -108,6 +157,10 @@ private:
   bool _isValidUpgrade(const char *line);
   bool _isValidConnection(char *value);
   bool _isValidVersion(uint8_t version);
+  /** @return Version number, 0 for anything but one or two digits. */
+  uint8_t _parseVersion(const char *value, size_t length);
+  /** @brief 16 bytes in base64: 22 characters and "==". */
+  bool _isValidSecKey(const char *value, size_t length);
   WebSocketError _validateHandshake(uint8_t flags, const char *secKey);
   void _rejectRequest(NetClient &, const WebSocketError code);
   void _acceptRequest(NetClient &, const char *secKey, const char *protocol);
@@ -116,7 +169,12 @@ private:
   /** @endcond */
 private:
   NetServer m_server;
+  uint16_t m_port;
+  /** @brief Open connections; slot i, when in use, points to m_pool[i]. */
   WebSocket *m_sockets[kMaxConnections]{};
+  /** @brief kMaxConnections connection objects, built by begin(). */
+  WebSocket *m_pool{nullptr};
+  WebSocketMetrics m_metrics;
 
   verifyClientCallback _verifyClient{nullptr};
   protocolHandlerCallback _protocolHandler{nullptr};
@@ -32,5 +32,26 @@
 
 /** Maximum size of data buffer - frame payload (in bytes). */
 constexpr uint16_t kBufferMaxSize{256};
+/**
+ * Size of the per-connection receive buffer (in bytes). Frame headers and
+ * small payloads are decoded from it; larger payloads are read straight into
+ * the data buffer.
+ */
+constexpr uint16_t kReceiveBufferSize{128};
+/** Size of the per-connection staging buffer for outgoing frames (in bytes). */
+constexpr uint16_t kSendBufferSize{128};
+/** Maximum length of a negotiated subprotocol name (with the terminator). */
+constexpr uint8_t kMaxProtocolLength{32};
+/**
+ * Maximum length of the requested subprotocol list, without spaces (longer
+ * lists are rejected with 400 Bad Request).
+ */
+constexpr uint8_t kMaxProtocolListLength{64};
+/**
+ * Maximum length of a handshake header line read from the server's own port,
+ * and of the header name/value handed to verifyClient (longer ones are
+ * rejected, not cut off).
+ */
+constexpr uint8_t kMaxHeaderLineLength{160};
 /** Maximum time to wait for endpoint response (in milliseconds). */
 constexpr uint16_t kTimeoutInterval{5000};
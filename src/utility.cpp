@@ -35,4 +35,38 @@ IPAddress fetchRemoteIp(const NetClient &client) {
   return const_cast<NetClient &>(client).remoteIP();
 }
 
+const char *firstHeader(const char *request) {
+  const char *lineEnd{request ? strchr(request, '\n') : nullptr};
+  return lineEnd ? lineEnd + 1 : nullptr;
+}
+
+const char *nextHeader(const char *position, HeaderField &field) {
+  if (!position) return nullptr;
+  const size_t lineLength{strcspn(position, "\r\n")};
+  if (lineLength == 0) return nullptr; // empty line (or end of the request)
+
+  const char *lineEnd{position + lineLength};
+  const auto colon =
+    static_cast<const char *>(memchr(position, ':', lineLength));
+  field.name = position;
+  field.nameLength = colon ? colon - position : 0;
+
+  const char *value{colon ? colon + 1 : lineEnd};
+  while (value < lineEnd && (*value == ' ' || *value == '\t')) ++value;
+  const char *valueEnd{lineEnd};
+  while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t'))
+    --valueEnd;
+  field.value = value;
+  field.valueLength = valueEnd - value;
+
+  if (*lineEnd == '\r') ++lineEnd;
+  if (*lineEnd == '\n') ++lineEnd;
+  return lineEnd;
+}
+
+bool isHeader(const HeaderField &field, const char *name) {
+  return field.nameLength == strlen(name) &&
+         strncasecmp(field.name, name, field.nameLength) == 0;
+}
+
 } // namespace net
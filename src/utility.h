@@ -43,4 +43,23 @@ namespace net {
 
 IPAddress fetchRemoteIp(const NetClient &);
 
+/** @brief One "Name: value" line of a request, pointing into it. */
+struct HeaderField {
+  const char *name;
+  size_t nameLength; ///< 0 for a line without a colon
+  const char *value; ///< Without the surrounding spaces
+  size_t valueLength;
+};
+
+/** @return First header line of a request (after the request line). */
+const char *firstHeader(const char *request);
+/**
+ * @brief Reads the header line at position, e.g.
+ * `while ((line = nextHeader(line, field))) ...`
+ * @return The line after it, nullptr at the end of the headers.
+ */
+const char *nextHeader(const char *position, HeaderField &field);
+/** @brief Case-insensitive header name comparison. */
+bool isHeader(const HeaderField &field, const char *name);
+
 } // namespace net